@@ -17,7 +17,7 @@ void countSort(int *array, int n) {
 
     for (int i = 0; i < n; i++) counts[array[i] - min]++;
 
-    for (int i = 1; i <= range; i++) counts[i] += counts[i - 1];
+    for (int i = 1; i < range; i++) counts[i] += counts[i - 1];
 
     int *res = malloc(sizeof(int) * n);
 
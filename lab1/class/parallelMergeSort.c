@@ -0,0 +1,351 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// короткие отрезки дешевле досортировать вставками, чем дробить дальше
+#define INSERTION_THRESHOLD 32
+// после стольких побед одного отрезка подряд переходим в режим галопа
+#define GALLOP_MIN 7
+// меньшие отрезки не стоят создания потока
+#define PARALLEL_THRESHOLD (1 << 16)
+
+#define AT(base, i) ((char*)(base) + (size_t)(i) * ctx->size)
+
+typedef int (*Comparator)(const void*, const void*);
+
+typedef struct SortCtx {
+    size_t size;
+    Comparator cmp;
+} SortCtx;
+
+// копирование одного элемента; для типичных размеров обходимся без вызова memcpy
+static inline void copyItem(const SortCtx *ctx, char *to, const char *from) {
+    switch (ctx->size) {
+        case 4: memcpy(to, from, 4); break;
+        case 8: memcpy(to, from, 8); break;
+        case 16: memcpy(to, from, 16); break;
+        default: memcpy(to, from, ctx->size);
+    }
+}
+
+// вставками переносим n элементов из from в to (буферы не пересекаются)
+static void insertionSort(const SortCtx *ctx, const char *from, char *to, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        const char *item = AT(from, i);
+
+        // ищем место после всех равных элементов, чтобы сохранить стабильность
+        size_t lo = 0;
+        size_t hi = i;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (ctx->cmp(AT(to, mid), item) <= 0) lo = mid + 1;
+            else hi = mid;
+        }
+
+        memmove(AT(to, lo + 1), AT(to, lo), (i - lo) * ctx->size);
+        copyItem(ctx, AT(to, lo), item);
+    }
+}
+
+// количество элементов base[0..n), не превосходящих key
+static size_t gallopRight(const SortCtx *ctx, const char *key, const char *base, size_t n) {
+    size_t hi = 1;
+    while (hi <= n && ctx->cmp(AT(base, hi - 1), key) <= 0) hi *= 2;
+
+    size_t lo = hi / 2;
+    if (hi > n) hi = n;
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (ctx->cmp(AT(base, mid), key) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+
+    return lo;
+}
+
+// количество элементов base[0..n), строго меньших key
+static size_t gallopLeft(const SortCtx *ctx, const char *key, const char *base, size_t n) {
+    size_t hi = 1;
+    while (hi <= n && ctx->cmp(AT(base, hi - 1), key) < 0) hi *= 2;
+
+    size_t lo = hi / 2;
+    if (hi > n) hi = n;
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (ctx->cmp(AT(base, mid), key) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+
+    return lo;
+}
+
+static void merge(const SortCtx *ctx, const char *L, size_t nl, const char *R, size_t nr, char *out) {
+    size_t i = 0;
+    size_t j = 0;
+    size_t k = 0;
+
+    // отрезки уже идут по порядку - просто копируем
+    if (nl > 0 && nr > 0 && ctx->cmp(AT(L, nl - 1), R) <= 0) {
+        memcpy(out, L, nl * ctx->size);
+        memcpy(AT(out, nl), R, nr * ctx->size);
+        return;
+    }
+
+    while (i < nl && j < nr) {
+        size_t winsL = 0;
+        size_t winsR = 0;
+
+        // обычный режим: по одному элементу
+        while (i < nl && j < nr) {
+            if (ctx->cmp(AT(R, j), AT(L, i)) < 0) {
+                copyItem(ctx, AT(out, k++), AT(R, j++));
+                winsR++;
+                winsL = 0;
+                if (winsR >= GALLOP_MIN) break;
+            } else {
+                copyItem(ctx, AT(out, k++), AT(L, i++));
+                winsL++;
+                winsR = 0;
+                if (winsL >= GALLOP_MIN) break;
+            }
+        }
+
+        // режим галопа: целыми блоками, пока блоки остаются длинными
+        size_t countL = 0;
+        size_t countR = 0;
+
+        do {
+            if (i >= nl || j >= nr) break;
+
+            countL = gallopRight(ctx, AT(R, j), AT(L, i), nl - i);
+            memcpy(AT(out, k), AT(L, i), countL * ctx->size);
+            i += countL;
+            k += countL;
+            if (i >= nl) break;
+
+            copyItem(ctx, AT(out, k++), AT(R, j++));
+            if (j >= nr) break;
+
+            countR = gallopLeft(ctx, AT(L, i), AT(R, j), nr - j);
+            memcpy(AT(out, k), AT(R, j), countR * ctx->size);
+            j += countR;
+            k += countR;
+            if (j >= nr) break;
+
+            copyItem(ctx, AT(out, k++), AT(L, i++));
+        } while (countL >= GALLOP_MIN || countR >= GALLOP_MIN);
+    }
+
+    memcpy(AT(out, k), AT(L, i), (nl - i) * ctx->size);
+    k += nl - i;
+    memcpy(AT(out, k), AT(R, j), (nr - j) * ctx->size);
+}
+
+// сколько элементов L попадает в первые k элементов слияния (merge path)
+static size_t mergePath(const SortCtx *ctx, const char *L, size_t nl, const char *R, size_t nr, size_t k) {
+    size_t lo = k > nr ? k - nr : 0;
+    size_t hi = k < nl ? k : nl;
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        // L[mid] не больше R[k - mid - 1] => L[mid] точно среди первых k
+        if (ctx->cmp(AT(L, mid), AT(R, k - mid - 1)) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+
+    return lo;
+}
+
+typedef struct MergeTask {
+    const SortCtx *ctx;
+    const char *L;
+    size_t nl;
+    const char *R;
+    size_t nr;
+    char *out;
+    size_t from;
+    size_t to;
+} MergeTask;
+
+static void *mergeTaskRun(void *arg) {
+    MergeTask *task = arg;
+    const SortCtx *ctx = task->ctx;
+
+    size_t i0 = mergePath(ctx, task->L, task->nl, task->R, task->nr, task->from);
+    size_t i1 = mergePath(ctx, task->L, task->nl, task->R, task->nr, task->to);
+    size_t j0 = task->from - i0;
+    size_t j1 = task->to - i1;
+
+    merge(ctx, AT(task->L, i0), i1 - i0, AT(task->R, j0), j1 - j0, AT(task->out, task->from));
+    return NULL;
+}
+
+// делим выход на равные куски и сливаем каждый в своем потоке
+static void parallelMerge(const SortCtx *ctx, const char *L, size_t nl, const char *R, size_t nr, char *out, int threads) {
+    size_t n = nl + nr;
+
+    if (threads <= 1 || n < PARALLEL_THRESHOLD) {
+        merge(ctx, L, nl, R, nr, out);
+        return;
+    }
+
+    MergeTask *tasks = malloc(sizeof(MergeTask) * threads);
+    pthread_t *ids = malloc(sizeof(pthread_t) * threads);
+    bool *started = malloc(sizeof(bool) * threads);
+
+    for (int t = 0; t < threads; t++) {
+        MergeTask task = {ctx, L, nl, R, nr, out, n * t / threads, n * (t + 1) / threads};
+        tasks[t] = task;
+    }
+
+    started[0] = false;
+    for (int t = 1; t < threads; t++) {
+        started[t] = pthread_create(&ids[t], NULL, mergeTaskRun, &tasks[t]) == 0;
+        if (!started[t]) mergeTaskRun(&tasks[t]);
+    }
+
+    mergeTaskRun(&tasks[0]);
+
+    for (int t = 1; t < threads; t++) {
+        if (started[t]) pthread_join(ids[t], NULL);
+    }
+
+    free(tasks);
+    free(ids);
+    free(started);
+}
+
+// сортирует n элементов, лежащих в a; результат оказывается в b при inB, иначе в a
+static void sortRange(const SortCtx *ctx, char *a, char *b, size_t n, bool inB, int threads);
+
+typedef struct SortTask {
+    const SortCtx *ctx;
+    char *a;
+    char *b;
+    size_t n;
+    bool inB;
+    int threads;
+} SortTask;
+
+static void *sortTaskRun(void *arg) {
+    SortTask *task = arg;
+    sortRange(task->ctx, task->a, task->b, task->n, task->inB, task->threads);
+    return NULL;
+}
+
+static void sortRange(const SortCtx *ctx, char *a, char *b, size_t n, bool inB, int threads) {
+    if (n <= INSERTION_THRESHOLD) {
+        if (inB) {
+            insertionSort(ctx, a, b, n);
+        } else {
+            memcpy(b, a, n * ctx->size);
+            insertionSort(ctx, b, a, n);
+        }
+        return;
+    }
+
+    size_t nl = n / 2;
+    size_t nr = n - nl;
+
+    // половины кладем в противоположный буфер, тогда слияние вернет их на место без копирования
+    if (threads > 1 && n >= PARALLEL_THRESHOLD) {
+        SortTask left = {ctx, a, b, nl, !inB, threads / 2};
+        pthread_t id;
+
+        if (pthread_create(&id, NULL, sortTaskRun, &left) == 0) {
+            sortRange(ctx, AT(a, nl), AT(b, nl), nr, !inB, threads - threads / 2);
+            pthread_join(id, NULL);
+        } else {
+            sortRange(ctx, a, b, nl, !inB, 1);
+            sortRange(ctx, AT(a, nl), AT(b, nl), nr, !inB, 1);
+        }
+    } else {
+        sortRange(ctx, a, b, nl, !inB, 1);
+        sortRange(ctx, AT(a, nl), AT(b, nl), nr, !inB, 1);
+        threads = 1;
+    }
+
+    char *src = inB ? a : b;
+    char *dst = inB ? b : a;
+
+    parallelMerge(ctx, src, nl, AT(src, nl), nr, dst, threads);
+}
+
+// стабильная сортировка в интерфейсе qsort; threads <= 0 - по числу ядер
+void parallelMergeSort(void *base, size_t n, size_t size, Comparator cmp, int threads) {
+    if (n < 2) return;
+
+    if (threads <= 0) threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads <= 0) threads = 1;
+
+    SortCtx ctx = {size, cmp};
+    char *tmp = malloc(n * size);
+
+    sortRange(&ctx, base, tmp, n, false, threads);
+
+    free(tmp);
+}
+
+int cmpInt(const void *a, const void *b) {
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+bool isSorted(int *arr, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        if (arr[i - 1] > arr[i]) return false;
+    }
+    return true;
+}
+
+int main() {
+    int arr[] = {3, 14, 1, 5, 9, 2, 6, 5, 11, 4};
+    int n = sizeof(arr) / sizeof(int);
+
+    parallelMergeSort(arr, n, sizeof(int), cmpInt, 0);
+
+    for (int i = 0; i < n; i++) printf("%d ", arr[i]);
+    printf("\n");
+
+    size_t bigN = 10000000;
+    int *source = malloc(sizeof(int) * bigN);
+    int *work = malloc(sizeof(int) * bigN);
+
+    srand(42);
+    for (size_t i = 0; i < bigN; i++) source[i] = rand();
+
+    memcpy(work, source, sizeof(int) * bigN);
+    double start = now();
+    qsort(work, bigN, sizeof(int), cmpInt);
+    printf("qsort: %fms\n", now() - start);
+
+    int threadCounts[] = {1, 0};
+    for (int t = 0; t < 2; t++) {
+        memcpy(work, source, sizeof(int) * bigN);
+        start = now();
+        parallelMergeSort(work, bigN, sizeof(int), cmpInt, threadCounts[t]);
+        printf("merge (threads=%d): %fms, sorted: %d\n", threadCounts[t], now() - start, isSorted(work, bigN));
+    }
+
+    // на уже отсортированных данных срабатывает галоп
+    start = now();
+    parallelMergeSort(work, bigN, sizeof(int), cmpInt, 1);
+    printf("merge presorted (threads=1): %fms, sorted: %d\n", now() - start, isSorted(work, bigN));
+
+    free(source);
+    free(work);
+    return 0;
+}
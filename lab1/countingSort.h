@@ -0,0 +1,35 @@
+#ifndef LAB1_COUNTING_SORT_H
+#define LAB1_COUNTING_SORT_H
+
+#include <inttypes.h>
+
+// Сортировки подсчетом lab1 для бенчмарков. Реализации:
+// fusedHistogram, pairHistogram, countingSort - task/main.c (объектник с -Dmain=taskMain),
+// countingSortInPlace - task/benchmark/americanFlagSort.c, countSort - class/countSort.c.
+// Обобщенная версия для C++ (любой ключ, radix, слияние) - sort.hpp
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Pair повторяет определение из task/main.c: посылка не подключает этот заголовок
+typedef struct Pair {
+    uint16_t key;
+    uint64_t value;
+} Pair;
+
+#define KEY_SPACE (UINT16_MAX + 1)
+
+int* fusedHistogram (Pair *arr, int n, uint16_t *min, uint16_t *max);
+int* pairHistogram (Pair *arr, int n, uint16_t *min, uint16_t *max);
+// стабильная, результат - новый массив
+Pair* countingSort (Pair *arr, int n);
+// американский флаг на месте, нестабильная
+void countingSortInPlace (Pair *arr, int n);
+void countSort(int *array, int n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,273 @@
+#ifndef LAB1_SORT_HPP
+#define LAB1_SORT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Общая библиотека сортировок lab1: сортировка подсчетом, LSD radix и слиянием.
+//
+//   lab1::sort(arr, n);                                        // ключ - сам элемент
+//   lab1::sort(arr, n, lab1::MemberKey<Pair, uint16_t, &Pair::key>());
+//   lab1::Sorter<Pair, PairKey, false, 11>::sort(arr, n);       // нестабильно, цифра 11 бит
+//
+// Для целочисленных ключей стратегия выбирается по n и диапазону ключей,
+// для остальных (строки, double, ...) на этапе компиляции остается только слияние.
+// C программы lab1 (task/main.c, class/countSort.c) самодостаточны, бенчмарки берут их сортировки через countingSort.h.
+
+namespace lab1 {
+
+template <typename T>
+struct Identity {
+    const T& operator()(const T &x) const { return x; }
+};
+
+// ключ - поле структуры
+template <typename T, typename K, K T::*Field>
+struct MemberKey {
+    K operator()(const T &x) const { return x.*Field; }
+};
+
+enum class Strategy { Insertion, Counting, Radix, Merge };
+
+template <typename T, typename KeyOf>
+using KeyType = std::decay_t<std::invoke_result_t<KeyOf, const T&>>;
+
+// T      - тип элемента (должен иметь конструктор по умолчанию)
+// KeyOf  - функтор, достающий ключ из элемента
+// Stable - сохранять ли порядок равных ключей
+// DigitBits - ширина цифры radix сортировки
+// KeyBits   - сколько младших бит ключа (после вычитания минимума) может понадобиться;
+//             если реальный диапазон шире, сортируем слиянием
+template <typename T, typename KeyOf = Identity<T>, bool Stable = true, unsigned DigitBits = 8,
+          unsigned KeyBits = sizeof(KeyType<T, KeyOf>) * 8>
+class Sorter {
+public:
+    using Key = KeyType<T, KeyOf>;
+
+    static constexpr bool IntegerKey = std::is_integral_v<Key> && !std::is_same_v<Key, bool>;
+    static constexpr size_t Radix = size_t(1) << DigitBits;
+    static constexpr unsigned MaxPasses = (KeyBits + DigitBits - 1) / DigitBits;
+
+    static constexpr size_t InsertionThreshold = 32;
+    // подсчет выгоден, пока таблица счетчиков не сильно больше массива
+    static constexpr uint64_t CountingRangeFactor = 2;
+    static constexpr uint64_t CountingMaxRange = uint64_t(1) << 24;
+
+    static_assert(DigitBits >= 1 && DigitBits <= 16, "digit must be 1..16 bits");
+    static_assert(!IntegerKey || (KeyBits >= 1 && KeyBits <= 64), "key must be 1..64 bits");
+
+    // span - разность максимального и минимального ключа
+    static Strategy choose(size_t n, uint64_t span) {
+        if (n <= InsertionThreshold) return Strategy::Insertion;
+        if constexpr (!IntegerKey) {
+            return Strategy::Merge;
+        } else {
+            if (span < CountingMaxRange && span < CountingRangeFactor * n + Radix) return Strategy::Counting;
+            if (passesFor(span) <= MaxPasses) return Strategy::Radix;
+            return Strategy::Merge;
+        }
+    }
+
+    static void sort(T *data, size_t n, KeyOf keyOf = KeyOf()) {
+        if (n < 2) return;
+
+        if constexpr (!IntegerKey) {
+            if (n <= InsertionThreshold) insertionSort(data, n, keyOf);
+            else mergeSort(data, n, keyOf);
+        } else {
+            Key min = keyOf(data[0]);
+            Key max = min;
+
+            for (size_t i = 1; i < n; i++) {
+                Key key = keyOf(data[i]);
+                if (key < min) min = key;
+                if (key > max) max = key;
+            }
+
+            uint64_t span = offset(max, min);
+
+            switch (choose(n, span)) {
+                case Strategy::Insertion: insertionSort(data, n, keyOf); break;
+                case Strategy::Counting: countingSort(data, n, keyOf, min, span); break;
+                case Strategy::Radix: radixSort(data, n, keyOf, min, span); break;
+                case Strategy::Merge: mergeSort(data, n, keyOf); break;
+            }
+        }
+    }
+
+private:
+    // расстояние от min до key; для знаковых ключей работает по модулю 2^64
+    static uint64_t offset(Key key, Key min) {
+        if constexpr (IntegerKey) {
+            return uint64_t(key) - uint64_t(min);
+        } else {
+            return 0;
+        }
+    }
+
+    static unsigned passesFor(uint64_t span) {
+        unsigned bits = 0;
+        while (bits < 64 && (span >> bits) != 0) bits++;
+        if (bits == 0) bits = 1;
+        return (bits + DigitBits - 1) / DigitBits;
+    }
+
+    static bool less(const T &a, const T &b, KeyOf &keyOf) {
+        return keyOf(a) < keyOf(b);
+    }
+
+    static void insertionSort(T *data, size_t n, KeyOf &keyOf) {
+        for (size_t i = 1; i < n; i++) {
+            T item = std::move(data[i]);
+            size_t j = i;
+
+            while (j > 0 && less(item, data[j - 1], keyOf)) {
+                data[j] = std::move(data[j - 1]);
+                j--;
+            }
+
+            data[j] = std::move(item);
+        }
+    }
+
+    static void countingSort(T *data, size_t n, KeyOf &keyOf, Key min, uint64_t span) {
+        std::vector<size_t> counts(span + 1, 0);
+        for (size_t i = 0; i < n; i++) counts[offset(keyOf(data[i]), min)]++;
+
+        if constexpr (Stable) {
+            for (size_t i = 1; i <= span; i++) counts[i] += counts[i - 1];
+
+            std::vector<T> res(n);
+            for (size_t i = n; i-- > 0;) {
+                res[--counts[offset(keyOf(data[i]), min)]] = std::move(data[i]);
+            }
+
+            std::move(res.begin(), res.end(), data);
+        } else {
+            // американский флаг: переставляем циклами прямо в массиве
+            std::vector<size_t> next(span + 1);
+            next[0] = 0;
+            for (size_t i = 1; i <= span; i++) {
+                next[i] = counts[i - 1];
+                counts[i] += counts[i - 1];
+            }
+
+            for (size_t b = 0; b <= span; b++) {
+                while (next[b] < counts[b]) {
+                    T item = std::move(data[next[b]]);
+                    size_t k = offset(keyOf(item), min);
+
+                    while (k != b) {
+                        std::swap(item, data[next[k]++]);
+                        k = offset(keyOf(item), min);
+                    }
+
+                    data[next[b]++] = std::move(item);
+                }
+            }
+        }
+    }
+
+    // LSD radix: все гистограммы за один проход, затем по проходу на цифру
+    static void radixSort(T *data, size_t n, KeyOf &keyOf, Key min, uint64_t span) {
+        unsigned passes = passesFor(span);
+        uint64_t mask = Radix - 1;
+
+        std::vector<size_t> hist(size_t(passes) * Radix, 0);
+        for (size_t i = 0; i < n; i++) {
+            uint64_t key = offset(keyOf(data[i]), min);
+            for (unsigned p = 0; p < passes; p++) {
+                hist[p * Radix + ((key >> (p * DigitBits)) & mask)]++;
+            }
+        }
+
+        std::vector<T> buffer(n);
+        T *from = data;
+        T *to = buffer.data();
+
+        for (unsigned p = 0; p < passes; p++) {
+            size_t *counts = hist.data() + p * Radix;
+            unsigned shift = p * DigitBits;
+
+            // все ключи с одной цифрой - проход ничего не меняет
+            if (counts[(offset(keyOf(from[0]), min) >> shift) & mask] == n) continue;
+
+            size_t sum = 0;
+            for (size_t d = 0; d < Radix; d++) {
+                size_t count = counts[d];
+                counts[d] = sum;
+                sum += count;
+            }
+
+            for (size_t i = 0; i < n; i++) {
+                uint64_t digit = (offset(keyOf(from[i]), min) >> shift) & mask;
+                to[counts[digit]++] = std::move(from[i]);
+            }
+
+            std::swap(from, to);
+        }
+
+        if (from != data) std::move(from, from + n, data);
+    }
+
+    static void merge(T *L, size_t nl, T *R, size_t nr, T *out, KeyOf &keyOf) {
+        // отрезки уже идут по порядку
+        if (!less(R[0], L[nl - 1], keyOf)) {
+            std::move(L, L + nl, out);
+            std::move(R, R + nr, out + nl);
+            return;
+        }
+
+        size_t i = 0;
+        size_t j = 0;
+        size_t k = 0;
+
+        while (i < nl && j < nr) {
+            if (less(R[j], L[i], keyOf)) out[k++] = std::move(R[j++]);
+            else out[k++] = std::move(L[i++]);
+        }
+
+        std::move(L + i, L + nl, out + k);
+        std::move(R + j, R + nr, out + k + (nl - i));
+    }
+
+    // сортирует a[0..n); результат в b при inB, иначе в a
+    static void mergeRange(T *a, T *b, size_t n, bool inB, KeyOf &keyOf) {
+        if (n <= InsertionThreshold) {
+            insertionSort(a, n, keyOf);
+            if (inB) std::move(a, a + n, b);
+            return;
+        }
+
+        size_t nl = n / 2;
+        mergeRange(a, b, nl, !inB, keyOf);
+        mergeRange(a + nl, b + nl, n - nl, !inB, keyOf);
+
+        T *src = inB ? a : b;
+        T *dst = inB ? b : a;
+        merge(src, nl, src + nl, n - nl, dst, keyOf);
+    }
+
+    static void mergeSort(T *data, size_t n, KeyOf &keyOf) {
+        std::vector<T> buffer(n);
+        mergeRange(data, buffer.data(), n, false, keyOf);
+    }
+};
+
+template <typename T, typename KeyOf = Identity<T>>
+void sort(T *data, size_t n, KeyOf keyOf = KeyOf()) {
+    Sorter<T, KeyOf>::sort(data, n, keyOf);
+}
+
+template <typename T, typename KeyOf = Identity<T>>
+void unstableSort(T *data, size_t n, KeyOf keyOf = KeyOf()) {
+    Sorter<T, KeyOf, false>::sort(data, n, keyOf);
+}
+
+}  // namespace lab1
+
+#endif
@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <inttypes.h>
+#include <sys/resource.h>
+
+#include "../../countingSort.h"
+
+#define MAX_INPUT_LENGTH 30
+
+// НЕСТАБИЛЬНАЯ сортировка: пары с равными ключами могут поменяться местами.
+// Годится только там, где порядок значений внутри одного ключа не важен.
+void countingSortInPlace (Pair *arr, int n) {
+    if (n < 1) return;
+    uint16_t min, max;
+
+    // ends[k] - конец корзины k, next[k] - первая еще не заполненная позиция в ней
+    int *ends = pairHistogram(arr, n, &min, &max);
+    int range = max - min + 1;
+    int *next = malloc(sizeof(int) * range);
+
+    next[0] = 0;
+    for (int i = 1; i < range; i++) {
+        ends[i] += ends[i - 1];
+        next[i] = ends[i - 1];
+    }
+
+    // американский флаг: каждый элемент переносим сразу в его корзину,
+    // вытесненный элемент продолжает цикл перестановки
+    for (int b = 0; b < range; b++) {
+        while (next[b] < ends[b]) {
+            Pair item = arr[next[b]];
+            int k = item.key - min;
+
+            while (k != b) {
+                Pair displaced = arr[next[k]];
+                arr[next[k]++] = item;
+                item = displaced;
+                k = item.key - min;
+            }
+
+            arr[next[b]++] = item;
+        }
+    }
+
+    free(ends);
+    free(next);
+}
+
+int main () {
+    Pair *arr = NULL;
+    int capacity = 0;
+    int size = 0;
+
+    char str[MAX_INPUT_LENGTH];
+
+    while (fgets(str, MAX_INPUT_LENGTH, stdin)) {
+        if (str[0] == '\n' || str[0] == '\0') continue;
+
+        if (size >= capacity) {
+            capacity += 10;
+            arr = realloc(arr, sizeof(Pair) * capacity);
+        }
+
+        int scanRes = sscanf(str, "%hu %lu", &(arr[size].key), &(arr[size].value)); 
+        if (scanRes == 2) size++;
+    }
+
+    clock_t start = clock();
+    countingSortInPlace(arr, size);
+    double timePassed = (double)(clock() - start) / CLOCKS_PER_SEC * 1000.0;
+    
+    for (int i = 0; i < size; i++) {
+        printf("%hu\t%lu\n", arr[i].key, arr[i].value);
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("time: %fms\n", timePassed);
+    printf("maxrss: %ldKB\n", usage.ru_maxrss);
+
+    free(arr);
+    
+    return 0;
+}
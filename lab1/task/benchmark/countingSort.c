@@ -2,42 +2,11 @@
 #include <stdlib.h>
 #include <time.h>
 #include <inttypes.h>
+#include <sys/resource.h>
 
-#define MAX_INPUT_LENGTH 30
-
-typedef struct Pair {
-    uint16_t key;
-    uint64_t value;
-} Pair;
-
-Pair* countingSort (Pair *arr, int n) {
-    if (n < 1) return NULL; 
-    uint16_t min = arr[0].key, max = arr[0].key;
-
-    for (int i = 1; i < n; i++) {
-        if (arr[i].key < min) min = arr[i].key;
-        if (arr[i].key > max) max = arr[i].key;
-    }
-
-    int range = max - min + 1;
-    
-    int *counts = malloc(sizeof(unsigned int) * range);
-    for (int i = 0; i < range; i++) counts[i] = 0;
-    
-    for (int i = 0; i < n; i++) counts[arr[i].key - min]++;
-    
-    for (int i = 1; i < range; i++) counts[i] += counts[i - 1];
-
-    Pair *res = malloc(sizeof(Pair) * n);
-
-    for (int i = n - 1; i >= 0; i--) {
-        res[--counts[arr[i].key - min]] = arr[i];
-    }
-    
-    free(counts);
+#include "../../countingSort.h"
 
-    return res;
-}
+#define MAX_INPUT_LENGTH 30
 
 int main () {
     Pair *arr = NULL;
@@ -66,7 +35,11 @@ int main () {
         printf("%hu\t%lu\n", sorted[i].key, sorted[i].value);
     }
 
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
     printf("time: %fms\n", timePassed);
+    printf("maxrss: %ldKB\n", usage.ru_maxrss);
 
     free(arr);
     free(sorted);
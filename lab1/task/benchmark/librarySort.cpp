@@ -0,0 +1,59 @@
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <cinttypes>
+#include <sys/resource.h>
+
+#include "../../countingSort.h"
+#include "../../sort.hpp"
+
+#define MAX_INPUT_LENGTH 30
+
+typedef lab1::MemberKey<Pair, uint16_t, &Pair::key> PairKey;
+
+// точка входа для sortBench.c
+extern "C" void librarySort (Pair *arr, int n) {
+    lab1::sort(arr, n, PairKey());
+}
+
+extern "C" void libraryUnstableSort (Pair *arr, int n) {
+    lab1::unstableSort(arr, n, PairKey());
+}
+
+int main () {
+    Pair *arr = NULL;
+    int capacity = 0;
+    int size = 0;
+
+    char str[MAX_INPUT_LENGTH];
+
+    while (fgets(str, MAX_INPUT_LENGTH, stdin)) {
+        if (str[0] == '\n' || str[0] == '\0') continue;
+
+        if (size >= capacity) {
+            capacity += 10;
+            arr = (Pair*)realloc(arr, sizeof(Pair) * capacity);
+        }
+
+        int scanRes = sscanf(str, "%hu %lu", &(arr[size].key), &(arr[size].value)); 
+        if (scanRes == 2) size++;
+    }
+
+    clock_t start = clock();
+    librarySort(arr, size);
+    double timePassed = (double)(clock() - start) / CLOCKS_PER_SEC * 1000.0;
+    
+    for (int i = 0; i < size; i++) {
+        printf("%hu\t%lu\n", arr[i].key, arr[i].value);
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("time: %fms\n", timePassed);
+    printf("maxrss: %ldKB\n", usage.ru_maxrss);
+
+    free(arr);
+    
+    return 0;
+}
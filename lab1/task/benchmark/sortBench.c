@@ -0,0 +1,343 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "../../countingSort.h"
+
+// сортировки подключаются отдельными объектниками, собранными с -Dmain=<имя>Main;
+// countingSort - из посылки task/main.c, остальные сортировки подсчетом - см. countingSort.h
+
+#define MIN_SIZE 1000
+#define DEFAULT_MAX_SIZE 10000000
+#define ZIPF_S 1.1
+#define FEW_UNIQUE 16
+
+int cmp (const void * a, const void * b);
+void librarySort (Pair *arr, int n);
+void libraryUnstableSort (Pair *arr, int n);
+void mergeSort(int *arr, int n);
+void parallelMergeSort(void *base, size_t n, size_t size, int (*cmp)(const void*, const void*), int threads);
+int cmpInt(const void *a, const void *b);
+
+// ================ варианты ================
+
+// возвращает указатель на отсортированные данные: либо data, либо новый буфер
+typedef void* (*SortRun)(void *data, size_t n);
+
+typedef struct Variant {
+    const char *name;
+    bool onPairs;
+    bool stable;
+    SortRun run;
+} Variant;
+
+void* runCountingSort(void *data, size_t n) {
+    return countingSort(data, n);
+}
+
+void* runAmericanFlag(void *data, size_t n) {
+    countingSortInPlace(data, n);
+    return data;
+}
+
+void* runQsort(void *data, size_t n) {
+    qsort(data, n, sizeof(Pair), cmp);
+    return data;
+}
+
+void* runLibrarySort(void *data, size_t n) {
+    librarySort(data, n);
+    return data;
+}
+
+void* runLibraryUnstableSort(void *data, size_t n) {
+    libraryUnstableSort(data, n);
+    return data;
+}
+
+int cmpPair(const void *a, const void *b) {
+    uint16_t x = ((const Pair*)a)->key;
+    uint16_t y = ((const Pair*)b)->key;
+    return (x > y) - (x < y);
+}
+
+void* runParallelMergePairs(void *data, size_t n) {
+    parallelMergeSort(data, n, sizeof(Pair), cmpPair, 0);
+    return data;
+}
+
+void* runClassCountSort(void *data, size_t n) {
+    countSort(data, n);
+    return data;
+}
+
+void* runClassMergeSort(void *data, size_t n) {
+    mergeSort(data, n);
+    return data;
+}
+
+void* runParallelMergeInts(void *data, size_t n) {
+    parallelMergeSort(data, n, sizeof(int), cmpInt, 0);
+    return data;
+}
+
+Variant variants[] = {
+    {"task/countingSort", true, true, runCountingSort},
+    {"task/americanFlag", true, false, runAmericanFlag},
+    {"task/qsort", true, false, runQsort},
+    {"lib/sort", true, true, runLibrarySort},
+    {"lib/unstableSort", true, false, runLibraryUnstableSort},
+    {"class/parallelMerge/pair", true, true, runParallelMergePairs},
+    {"class/countSort", false, false, runClassCountSort},
+    {"class/mergeSort", false, false, runClassMergeSort},
+    {"class/parallelMerge/int", false, false, runParallelMergeInts},
+};
+
+// ================ генерация входа ================
+
+typedef enum Distribution {
+    UNIFORM,
+    ZIPF,
+    ALL_EQUAL,
+    PRESORTED,
+    REVERSE,
+    FEW_UNIQUE_KEYS,
+    DISTRIBUTION_COUNT
+} Distribution;
+
+const char *distributionNames[] = {"uniform", "zipf", "all-equal", "presorted", "reverse", "few-unique"};
+
+uint64_t rngState = 88172645463325252ULL;
+
+uint64_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return rngState;
+}
+
+double *zipfCdf = NULL;
+
+void initZipf() {
+    zipfCdf = malloc(sizeof(double) * KEY_SPACE);
+
+    double sum = 0;
+    for (int k = 0; k < KEY_SPACE; k++) {
+        sum += 1.0 / pow(k + 1, ZIPF_S);
+        zipfCdf[k] = sum;
+    }
+
+    for (int k = 0; k < KEY_SPACE; k++) zipfCdf[k] /= sum;
+}
+
+uint16_t zipfKey() {
+    double u = (nextRandom() >> 11) * (1.0 / 9007199254740992.0);
+
+    int lo = 0;
+    int hi = KEY_SPACE - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (zipfCdf[mid] < u) lo = mid + 1;
+        else hi = mid;
+    }
+
+    // частые ключи разбрасываем по всему диапазону, а не кладем в начало
+    return (uint16_t)(lo * 40503u);
+}
+
+void generate(Pair *arr, size_t n, Distribution dist) {
+    uint16_t few[FEW_UNIQUE];
+    for (int i = 0; i < FEW_UNIQUE; i++) few[i] = nextRandom();
+
+    for (size_t i = 0; i < n; i++) {
+        uint16_t key = 0;
+
+        switch (dist) {
+            case UNIFORM: key = nextRandom(); break;
+            case ZIPF: key = zipfKey(); break;
+            case ALL_EQUAL: key = 42; break;
+            case PRESORTED: key = (uint16_t)(i * KEY_SPACE / n); break;
+            case REVERSE: key = UINT16_MAX - (uint16_t)(i * KEY_SPACE / n); break;
+            case FEW_UNIQUE_KEYS: key = few[nextRandom() % FEW_UNIQUE]; break;
+            default: break;
+        }
+
+        arr[i].key = key;
+        // номер элемента во входе - по нему проверяем стабильность
+        arr[i].value = i;
+    }
+}
+
+// ================ счетчики perf ================
+
+typedef struct Counters {
+    int cyclesFd;
+    int missesFd;
+} Counters;
+
+int openCounter(uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+void startCounters(Counters *counters) {
+    if (counters->cyclesFd >= 0) {
+        ioctl(counters->cyclesFd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counters->cyclesFd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    if (counters->missesFd >= 0) {
+        ioctl(counters->missesFd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counters->missesFd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+// -1, если счетчик недоступен
+int64_t stopCounter(int fd) {
+    if (fd < 0) return -1;
+
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+    uint64_t value;
+    if (read(fd, &value, sizeof(value)) != sizeof(value)) return -1;
+    return value;
+}
+
+// ================ прогон ================
+
+double nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+bool checkPairs(Pair *arr, size_t n, bool stable) {
+    for (size_t i = 1; i < n; i++) {
+        if (arr[i - 1].key > arr[i].key) return false;
+        if (stable && arr[i - 1].key == arr[i].key && arr[i - 1].value > arr[i].value) return false;
+    }
+    return true;
+}
+
+bool checkInts(int *arr, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        if (arr[i - 1] > arr[i]) return false;
+    }
+    return true;
+}
+
+void printCounter(int64_t value, size_t n) {
+    if (value < 0) printf("%12s", "-");
+    else printf("%12.2f", (double)value / n);
+}
+
+void benchmark(Variant *variant, Pair *source, int *sourceInts, size_t n, Distribution dist, Counters *counters) {
+    size_t elemSize = variant->onPairs ? sizeof(Pair) : sizeof(int);
+    void *work = malloc(elemSize * n);
+    if (work == NULL) {
+        printf("%-26s %-11s %11zu   out of memory\n", variant->name, distributionNames[dist], n);
+        return;
+    }
+
+    int reps = n <= 1000000 ? 5 : n <= 100000000 ? 3 : 1;
+    double best = -1;
+    int64_t bestCycles = -1;
+    int64_t bestMisses = -1;
+    bool ok = true;
+
+    for (int r = 0; r < reps; r++) {
+        memcpy(work, variant->onPairs ? (void*)source : (void*)sourceInts, elemSize * n);
+
+        startCounters(counters);
+        double start = nowNs();
+        void *sorted = variant->run(work, n);
+        double elapsed = nowNs() - start;
+        int64_t cycles = stopCounter(counters->cyclesFd);
+        int64_t misses = stopCounter(counters->missesFd);
+
+        if (sorted == NULL) {
+            ok = false;
+            break;
+        }
+
+        ok = ok && (variant->onPairs ? checkPairs(sorted, n, variant->stable) : checkInts(sorted, n));
+        if (sorted != work) free(sorted);
+
+        if (best < 0 || elapsed < best) {
+            best = elapsed;
+            bestCycles = cycles;
+            bestMisses = misses;
+        }
+    }
+
+    free(work);
+
+    // MB/s - размер входа, деленный на время сортировки
+    printf("%-26s %-11s %11zu %10.2f %10.1f", variant->name, distributionNames[dist], n,
+        best / n, elemSize * n / best * 1000.0);
+    printCounter(bestCycles, n);
+    printCounter(bestMisses, n);
+    printf("%s\n", ok ? "" : "   FAILED");
+}
+
+// ./sortBench.out [maxSize], размеры идут степенями 10 от 1K до maxSize (не больше 1B)
+int main(int argc, char **argv) {
+    size_t maxSize = DEFAULT_MAX_SIZE;
+    if (argc > 1) maxSize = strtoull(argv[1], NULL, 10);
+    if (maxSize > 1000000000) maxSize = 1000000000;
+
+    initZipf();
+
+    Counters counters = {openCounter(PERF_COUNT_HW_CPU_CYCLES), openCounter(PERF_COUNT_HW_CACHE_MISSES)};
+    if (counters.cyclesFd < 0) printf("perf_event_open unavailable, cycles and misses are not reported\n");
+
+    printf("%-26s %-11s %11s %10s %10s %12s %12s\n", "variant", "dist", "n", "ns/elem", "MB/s", "cycles/elem", "misses/elem");
+
+    int variantCount = sizeof(variants) / sizeof(Variant);
+
+    for (size_t n = MIN_SIZE; n <= maxSize; n *= 10) {
+        Pair *source = malloc(sizeof(Pair) * n);
+        int *sourceInts = malloc(sizeof(int) * n);
+        if (source == NULL || sourceInts == NULL) {
+            printf("n = %zu: out of memory\n", n);
+            free(source);
+            free(sourceInts);
+            break;
+        }
+
+        for (int d = 0; d < DISTRIBUTION_COUNT; d++) {
+            generate(source, n, d);
+            for (size_t i = 0; i < n; i++) sourceInts[i] = source[i].key;
+
+            for (int v = 0; v < variantCount; v++) {
+                benchmark(&variants[v], source, sourceInts, n, d, &counters);
+            }
+        }
+
+        free(source);
+        free(sourceInts);
+    }
+
+    if (counters.cyclesFd >= 0) close(counters.cyclesFd);
+    if (counters.missesFd >= 0) close(counters.missesFd);
+    free(zipfCdf);
+
+    return 0;
+}
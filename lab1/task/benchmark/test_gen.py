@@ -0,0 +1,9 @@
+import random
+
+c = 1000000
+
+with open("in.txt", "w") as file:
+    for i in range(c):
+        k = random.randint(0, 2**16 - 1)
+        v = random.randint(0, 2**64 - 1)
+        file.write(f"{k} {v}\n")
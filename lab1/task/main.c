@@ -1,30 +1,108 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define MAX_INPUT_LENGTH 30
 
+// посылка собирается одна (gcc main.c); бенчмарки task/benchmark берут отсюда
+// countingSort, подключая файл объектником, собранным с -Dmain=taskMain
 typedef struct Pair {
     uint16_t key;
     uint64_t value;
 } Pair;
 
-Pair* countingSort (Pair *arr, int n) {
-    if (n < 1) return NULL; 
-    uint16_t min = arr[0].key, max = arr[0].key;
+// для больших массивов гистограмму строим сразу по всему пространству ключей:
+// тогда min/max не нужен отдельный проход, они находятся при сведении гистограмм
+#define KEY_SPACE (UINT16_MAX + 1)
+#define SUB_HISTOGRAMS 4
+#define FUSED_MIN_SIZE KEY_SPACE
+
+// подряд идущие одинаковые ключи попадают в разные подгистограммы,
+// поэтому инкременты не ждут друг друга через память
+int* fusedHistogram (Pair *arr, int n, uint16_t *min, uint16_t *max) {
+    int *sub = calloc((size_t)SUB_HISTOGRAMS * KEY_SPACE, sizeof(int));
+    int *h0 = sub;
+    int *h1 = sub + KEY_SPACE;
+    int *h2 = sub + 2 * KEY_SPACE;
+    int *h3 = sub + 3 * KEY_SPACE;
+
+    int i = 0;
+    for (; i + 3 < n; i += 4) {
+        h0[arr[i].key]++;
+        h1[arr[i + 1].key]++;
+        h2[arr[i + 2].key]++;
+        h3[arr[i + 3].key]++;
+    }
+    for (; i < n; i++) h0[arr[i].key]++;
+
+    int first = -1;
+    int last = -1;
+
+#ifdef __SSE2__
+    __m128i zero = _mm_setzero_si128();
+
+    for (int k = 0; k < KEY_SPACE; k += 4) {
+        __m128i sum = _mm_add_epi32(
+            _mm_add_epi32(_mm_loadu_si128((__m128i*)(h0 + k)), _mm_loadu_si128((__m128i*)(h1 + k))),
+            _mm_add_epi32(_mm_loadu_si128((__m128i*)(h2 + k)), _mm_loadu_si128((__m128i*)(h3 + k)))
+        );
+        _mm_storeu_si128((__m128i*)(h0 + k), sum);
+
+        // по биту на каждый ненулевой счетчик
+        int nonZero = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(sum, zero))) ^ 0xF;
+        if (nonZero) {
+            if (first == -1) first = k + __builtin_ctz(nonZero);
+            last = k + 31 - __builtin_clz(nonZero);
+        }
+    }
+#else
+    for (int k = 0; k < KEY_SPACE; k++) {
+        h0[k] += h1[k] + h2[k] + h3[k];
+        if (h0[k] != 0) {
+            if (first == -1) first = k;
+            last = k;
+        }
+    }
+#endif
+
+    *min = first;
+    *max = last;
+
+    // счетчики вне [min, max] не нужны, оставляем только этот отрезок
+    int *counts = realloc(sub, sizeof(int) * KEY_SPACE);
+    memmove(counts, counts + first, sizeof(int) * (last - first + 1));
+
+    return counts;
+}
+
+// counts[k - min] - число пар с ключом k; n > 0
+int* pairHistogram (Pair *arr, int n, uint16_t *min, uint16_t *max) {
+    if (n >= FUSED_MIN_SIZE) return fusedHistogram(arr, n, min, max);
 
+    *min = arr[0].key;
+    *max = arr[0].key;
     for (int i = 1; i < n; i++) {
-        if (arr[i].key < min) min = arr[i].key;
-        if (arr[i].key > max) max = arr[i].key;
+        if (arr[i].key < *min) *min = arr[i].key;
+        if (arr[i].key > *max) *max = arr[i].key;
     }
 
+    int *counts = calloc(*max - *min + 1, sizeof(int));
+    for (int i = 0; i < n; i++) counts[arr[i].key - *min]++;
+
+    return counts;
+}
+
+Pair* countingSort (Pair *arr, int n) {
+    if (n < 1) return NULL;
+    uint16_t min, max;
+    int *counts = pairHistogram(arr, n, &min, &max);
     int range = max - min + 1;
-    
-    int *counts = malloc(sizeof(unsigned int) * range);
-    for (int i = 0; i < range; i++) counts[i] = 0;
-    
-    for (int i = 0; i < n; i++) counts[arr[i].key - min]++;
-    
+
     for (int i = 1; i < range; i++) counts[i] += counts[i - 1];
 
     Pair *res = malloc(sizeof(Pair) * n);
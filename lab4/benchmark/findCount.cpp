@@ -0,0 +1,15 @@
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// std::string::find (как в find.cpp) над уже разобранными токенами: тот же шаблон
+// basic_string_view::find, только символ - uint32_t, поэтому вход у всех замеров один
+extern "C" size_t stringFindCount(const uint32_t *text, size_t n, const uint32_t *pattern, size_t m) {
+    std::basic_string_view<uint32_t> t(text, n);
+    std::basic_string_view<uint32_t> p(pattern, m);
+
+    size_t count = 0;
+    for (size_t pos = t.find(p); pos != std::basic_string_view<uint32_t>::npos; pos = t.find(p, pos + 1)) count++;
+
+    return count;
+}
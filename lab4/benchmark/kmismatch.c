@@ -0,0 +1,56 @@
+#include <time.h>
+
+// время поиска с k несовпадениями в зависимости от k, текст генерируется в памяти.
+// ./kmismatch.out [n] [m] [alphabet]
+#define main lab4Main
+#include "../main.c"
+#undef main
+
+uint64_t rngState = 88172645463325252ULL;
+
+uint64_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return rngState;
+}
+
+void countMatch(void *ctx, size_t start) {
+    (void)start;
+    (*(size_t*)ctx)++;
+}
+
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+    size_t m = argc > 2 ? strtoull(argv[2], NULL, 10) : 256;
+    uint32_t alphabet = argc > 3 ? strtoul(argv[3], NULL, 10) : 4;
+    if (m == 0 || m > n || alphabet == 0) return 1;
+
+    uint32_t *text = malloc(sizeof(uint32_t) * n);
+    for (size_t i = 0; i < n; i++) text[i] = nextRandom() % alphabet;
+
+    uint32_t *P = malloc(sizeof(uint32_t) * m);
+    memcpy(P, text + n / 2, sizeof(uint32_t) * m);
+
+    printf("n = %zu, m = %zu, alphabet = %u\n", n, m, alphabet);
+    printf("%6s %12s %12s %10s\n", "k", "matches", "time, ms", "ns/token");
+
+    size_t ks[] = {0, 1, 2, 4, 8, 16, 32, 64};
+    for (size_t t = 0; t < sizeof(ks) / sizeof(size_t); t++) {
+        size_t count = 0;
+
+        clock_t start = clock();
+        ApproxMatcher matcher = createApproxMatcher(P, m, ks[t], countMatch, &count);
+        for (size_t i = 0; i < n; i += BATCH_SIZE) {
+            feedApproxMatcher(matcher, text + i, n - i < BATCH_SIZE ? n - i : BATCH_SIZE);
+        }
+        deleteApproxMatcher(matcher);
+        double timePassed = (double)(clock() - start) / CLOCKS_PER_SEC * 1000.0;
+
+        printf("%6zu %12zu %12.1f %10.2f\n", ks[t], count, timePassed, timePassed * 1e6 / n);
+    }
+
+    free(text);
+    free(P);
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include <time.h>
+
+// поиск по уже разобранным токенам: чтение не входит в замер.
+// С -DNO_PREFILTER собирается обычный цикл KMP. Для сравнения на том же
+// массиве токенов замеряется std::string::find (findCount.cpp)
+#define main lab4Main
+#include "../main.c"
+#undef main
+
+size_t stringFindCount(const uint32_t *text, size_t n, const uint32_t *pattern, size_t m);
+
+void countMatch(void *ctx, size_t start) {
+    (void)start;
+    (*(size_t*)ctx)++;
+}
+
+int main() {
+    TextReader reader = createTextReader(stdin);
+
+    size_t m = 0;
+    uint32_t *P = readSequence(reader, &m);
+
+    size_t n = 0;
+    size_t cap = BATCH_SIZE;
+    uint32_t *text = malloc(sizeof(uint32_t) * cap);
+    Tokens batch = createTokens(BATCH_SIZE);
+
+    while (readTokens(reader, &batch, BATCH_SIZE, false) > 0) {
+        if (n + batch.size > cap) {
+            cap = (n + batch.size) * 2;
+            text = realloc(text, sizeof(uint32_t) * cap);
+        }
+
+        memcpy(text + n, batch.nums, sizeof(uint32_t) * batch.size);
+        n += batch.size;
+    }
+
+    deleteTokens(&batch);
+    deleteTextReader(reader);
+
+    printf("%zu %zu\n", n, m);
+
+    if (m > 0) {
+        size_t count = 0;
+
+        clock_t start = clock();
+        Matcher matcher = createMatcher(P, m, countMatch, &count);
+        feedMatcher(matcher, text, n);
+        deleteMatcher(matcher);
+        double timePassed = (double)(clock() - start) / CLOCKS_PER_SEC * 1000.0;
+
+        printf("matches: %zu\n", count);
+        printf("time: %fms\n", timePassed);
+
+        start = clock();
+        size_t findCount = stringFindCount(text, n, P, m);
+        timePassed = (double)(clock() - start) / CLOCKS_PER_SEC * 1000.0;
+
+        printf("find matches: %zu%s\n", findCount, findCount == count ? "" : "   MISMATCH");
+        printf("find time: %fms\n", timePassed);
+    }
+
+    free(P);
+    free(text);
+    return 0;
+}
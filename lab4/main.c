@@ -2,30 +2,105 @@
 #include <inttypes.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-#define EXTEND_SIZE 10
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-typedef struct Num {
-    uint32_t num;
-    size_t index;
-    int64_t line;
-} Num;
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// размер блока, читаемого из файла за раз
+#define BLOCK_SIZE (1 << 20)
+// сколько токенов разбираем за раз перед передачей в поиск
+#define BATCH_SIZE (1 << 16)
+
+// пачка разобранных токенов: числа и их позиции в параллельных массивах
+typedef struct Tokens {
+    uint32_t *nums;
+    int64_t *lines;
+    size_t *indexes;
+    size_t size;
+    size_t cap;
+} Tokens;
 
 typedef struct TextReader {
-    Num *buffer;
-    size_t bufSize;
-    size_t offset;
+    // NULL - читаем из памяти, весь текст уже лежит в block
+    FILE *file;
+    char *block;
+    bool ownsBlock;
+    size_t blockLen;
+    size_t blockPos;
+    bool eof;
+
+    // число, разорванное границей блока или пачки
+    uint32_t num;
+    bool parseNum;
 
     size_t lineNum;
     size_t lineIndex;
 } _TextReader, *TextReader;
 
-TextReader createTextReader(size_t patternSize) {
+Tokens createTokens(size_t cap) {
+    Tokens res;
+
+    res.nums = malloc(sizeof(uint32_t) * cap);
+    res.lines = malloc(sizeof(int64_t) * cap);
+    res.indexes = malloc(sizeof(size_t) * cap);
+    res.size = 0;
+    res.cap = cap;
+
+    return res;
+}
+
+void reserveTokens(Tokens *tokens, size_t cap) {
+    if (cap <= tokens->cap) return;
+
+    tokens->nums = realloc(tokens->nums, sizeof(uint32_t) * cap);
+    tokens->lines = realloc(tokens->lines, sizeof(int64_t) * cap);
+    tokens->indexes = realloc(tokens->indexes, sizeof(size_t) * cap);
+    tokens->cap = cap;
+}
+
+void deleteTokens(Tokens *tokens) {
+    free(tokens->nums);
+    free(tokens->lines);
+    free(tokens->indexes);
+}
+
+TextReader createTextReader(FILE *file) {
     TextReader res = malloc(sizeof(_TextReader));
-    
-    res->offset = 0;
-    res->bufSize = patternSize + 3;
-    res->buffer = malloc(sizeof(Num) * res->bufSize);
+
+    res->file = file;
+    res->block = malloc(BLOCK_SIZE);
+    res->ownsBlock = true;
+    res->blockLen = 0;
+    res->blockPos = 0;
+    res->eof = false;
+    res->num = 0;
+    res->parseNum = false;
+    res->lineNum = 0;
+    res->lineIndex = 0;
+
+    return res;
+}
+
+TextReader createMemoryReader(const char *data, size_t len) {
+    TextReader res = malloc(sizeof(_TextReader));
+
+    res->file = NULL;
+    res->block = (char*)data;
+    res->ownsBlock = false;
+    res->blockLen = len;
+    res->blockPos = 0;
+    res->eof = true;
+    res->num = 0;
+    res->parseNum = false;
     res->lineNum = 0;
     res->lineIndex = 0;
 
@@ -33,204 +108,1725 @@ TextReader createTextReader(size_t patternSize) {
 }
 
 void deleteTextReader(TextReader reader) {
-    free(reader->buffer);
+    if (reader->ownsBlock) free(reader->block);
     free(reader);
 }
 
-Num nextNum(TextReader reader) {
-    bool parseNum = false;
-    uint32_t num = 0;
+bool fillBlock(TextReader reader) {
+    if (reader->blockPos < reader->blockLen) return true;
+    if (reader->eof) return false;
 
-    while (1) {
-        int c = fgetc(stdin);
+    reader->blockLen = fread(reader->block, 1, BLOCK_SIZE, reader->file);
+    reader->blockPos = 0;
 
-        if (c == ' ' || c == '\n' || c == EOF) {
-            Num res = {num, reader->lineIndex, reader->lineNum};
+    if (reader->blockLen == 0) {
+        reader->eof = true;
+        return false;
+    }
 
-            if (!parseNum && c == EOF) {
-                res.line = -1;
-                return res;
-            } 
+    return true;
+}
 
-            if (parseNum) {
-                reader->lineIndex++;
-            }
+static inline void pushToken(TextReader reader, Tokens *tokens) {
+    tokens->nums[tokens->size] = reader->num;
+    tokens->lines[tokens->size] = reader->lineNum;
+    tokens->indexes[tokens->size] = reader->lineIndex;
+    tokens->size++;
+
+    reader->lineIndex++;
+    reader->num = 0;
+    reader->parseNum = false;
+}
+
+static inline void readSeparator(TextReader reader, Tokens *tokens, char c) {
+    if (reader->parseNum) {
+        pushToken(reader, tokens);
+    }
+
+    if (c == '\n') {
+        reader->lineNum++;
+        reader->lineIndex = 0;
+    }
+}
+
+// разбирает в tokens до max чисел, возвращает сколько разобрал (0 - конец файла).
+// Разделители - пробел и перевод строки, прочие символы пропускаются.
+// При lineOnly останавливается сразу после первого перевода строки.
+size_t readTokens(TextReader reader, Tokens *tokens, size_t max, bool lineOnly) {
+    tokens->size = 0;
+    reserveTokens(tokens, max);
+
+    while (tokens->size < max) {
+        if (!fillBlock(reader)) {
+            if (reader->parseNum) pushToken(reader, tokens);
+            break;
+        }
+
+        const char *s = reader->block;
+        size_t i = reader->blockPos;
+        size_t len = reader->blockLen;
+        bool lineEnd = false;
+
+#ifdef __SSE2__
+        // в 16 байтах не больше 9 чисел, поэтому проверяем запас заранее
+        while (i + 16 <= len && tokens->size + 16 <= max) {
+            __m128i chunk = _mm_loadu_si128((const __m128i*)(s + i));
+
+            int spaceMask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')));
+            int newlineMask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')));
+            __m128i digits = _mm_sub_epi8(chunk, _mm_set1_epi8('0'));
+            int digitMask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits));
+
+            int sepMask = spaceMask | newlineMask;
+
+            // посторонние символы или конец строки паттерна разбираем по байтам
+            if ((sepMask | digitMask) != 0xFFFF) break;
+            if (lineOnly && newlineMask != 0) break;
+
+            size_t from = i;
+            while (sepMask != 0) {
+                size_t sep = i + __builtin_ctz(sepMask);
 
-            if (c == '\n') {
-                reader->lineNum++;
-                reader->lineIndex = 0;
+                for (size_t j = from; j < sep; j++) {
+                    reader->num = reader->num * 10 + (s[j] - '0');
+                    reader->parseNum = true;
+                }
+
+                readSeparator(reader, tokens, s[sep]);
+                from = sep + 1;
+                sepMask &= sepMask - 1;
             }
 
-            if (parseNum) {
-                return res;
+            for (size_t j = from; j < i + 16; j++) {
+                reader->num = reader->num * 10 + (s[j] - '0');
+                reader->parseNum = true;
             }
+
+            i += 16;
         }
+#endif
+
+        // хвост блока и "грязные" участки - по одному байту
+        size_t scalarEnd = i + 16 < len ? i + 16 : len;
+        for (; i < scalarEnd && tokens->size < max; i++) {
+            char c = s[i];
+
+            if (c == ' ' || c == '\n') {
+                readSeparator(reader, tokens, c);
 
-        char letter = c;
-        if ('0' <= letter && letter <= '9') {
-            num = num * 10 + (letter - '0');
-            parseNum = true;
+                if (c == '\n' && lineOnly) {
+                    i++;
+                    lineEnd = true;
+                    break;
+                }
+            } else if ('0' <= c && c <= '9') {
+                reader->num = reader->num * 10 + (c - '0');
+                reader->parseNum = true;
+            }
         }
+
+        reader->blockPos = i;
+        if (lineEnd) break;
     }
+
+    return tokens->size;
 }
 
-Num getNum(TextReader reader, size_t index) {
-    while (reader->offset <= index ) {
-        reader->buffer[reader->offset % reader->bufSize] = nextNum(reader); 
-        if (reader->buffer[reader->offset % reader->bufSize].line == -1) {
-            return reader->buffer[reader->offset % reader->bufSize];
+// первая строка входа - паттерн
+uint32_t *readSequence(TextReader reader, size_t *size) {
+    Tokens pattern = createTokens(BATCH_SIZE);
+    size_t sequenceSize = 0;
+    uint32_t *sequence = malloc(sizeof(uint32_t) * BATCH_SIZE);
+    size_t sequenceCap = BATCH_SIZE;
+
+    size_t startLine = reader->lineNum;
+
+    while (reader->lineNum == startLine && readTokens(reader, &pattern, BATCH_SIZE, true) > 0) {
+        if (sequenceSize + pattern.size > sequenceCap) {
+            sequenceCap = (sequenceSize + pattern.size) * 2;
+            sequence = realloc(sequence, sizeof(uint32_t) * sequenceCap);
         }
-        
-        reader->offset++;
+
+        memcpy(sequence + sequenceSize, pattern.nums, sizeof(uint32_t) * pattern.size);
+        sequenceSize += pattern.size;
+    }
+
+    deleteTokens(&pattern);
+
+    // позиции в тексте считаются со строки после паттерна
+    reader->lineNum = 0;
+    reader->lineIndex = 0;
+
+    *size = sequenceSize;
+    return sequence;
+}
+
+// start - глобальный номер первого токена вхождения
+typedef void (*OnTokenMatch)(void *ctx, size_t start);
+
+// -DNO_PREFILTER отключает префильтр (для сравнения в benchmark)
+#ifdef NO_PREFILTER
+#define USE_PREFILTER 0
+#else
+#define USE_PREFILTER 1
+#endif
+
+// первая позиция i >= from, где nums[i] == first и nums[i + m - 1] == last.
+// Если i + m - 1 выходит за пачку, проверяется только first
+size_t findCandidate(uint32_t first, uint32_t last, size_t m, const uint32_t *nums, size_t n, size_t from) {
+    size_t i = from;
+
+#ifdef __AVX2__
+    __m256i firstVec = _mm256_set1_epi32(first);
+    __m256i lastVec = _mm256_set1_epi32(last);
+
+    while (i + m - 1 + 8 <= n) {
+        __m256i heads = _mm256_loadu_si256((const __m256i*)(nums + i));
+        __m256i tails = _mm256_loadu_si256((const __m256i*)(nums + i + m - 1));
+        __m256i both = _mm256_and_si256(_mm256_cmpeq_epi32(heads, firstVec), _mm256_cmpeq_epi32(tails, lastVec));
+
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(both));
+        if (mask != 0) return i + __builtin_ctz(mask);
+        i += 8;
+    }
+#elif defined(__SSE2__)
+    __m128i firstVec = _mm_set1_epi32(first);
+    __m128i lastVec = _mm_set1_epi32(last);
+
+    while (i + m - 1 + 4 <= n) {
+        __m128i heads = _mm_loadu_si128((const __m128i*)(nums + i));
+        __m128i tails = _mm_loadu_si128((const __m128i*)(nums + i + m - 1));
+        __m128i both = _mm_and_si128(_mm_cmpeq_epi32(heads, firstVec), _mm_cmpeq_epi32(tails, lastVec));
+
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(both));
+        if (mask != 0) return i + __builtin_ctz(mask);
+        i += 4;
     }
-    
-    return reader->buffer[index % reader->bufSize];
+#endif
+
+    for (; i < n; i++) {
+        if (nums[i] == first && (i + m - 1 >= n || nums[i + m - 1] == last)) return i;
+    }
+
+    return n;
 }
 
-uint32_t *readSequence(size_t *size) {
-    uint32_t *sequence = malloc(sizeof(uint32_t) * EXTEND_SIZE);
-    size_t sequenceCap = EXTEND_SIZE;
-    size_t sequenceSize = 0;
-    uint32_t num = 0;
-    bool parseNum = false;
-    
-    while (1) {
-        int symbol = fgetc(stdin);
-
-        if (symbol == '\n' || symbol == EOF) {
-            if (!parseNum) break;
-
-            if (sequenceSize >= sequenceCap) {
-                sequence = realloc(sequence, sizeof(uint32_t) * (sequenceCap + EXTEND_SIZE));
-                sequenceCap += EXTEND_SIZE;
-            }
+// Z и SP хранятся в самом узком типе, вмещающем значения до m - 1:
+// функции генерируются для 16, 32 и 64 бит, нужная выбирается по длине паттерна
+#define DEFINE_PREFIX_FUNCTIONS(bits)                                                       \
+uint##bits##_t *calcZ##bits(uint32_t *s, size_t m) {                                        \
+    uint##bits##_t *Z = malloc(sizeof(uint##bits##_t) * m);                                \
+                                                                                            \
+    size_t l = 0;                                                                           \
+    size_t r = 0;                                                                           \
+                                                                                            \
+    if (m > 0) Z[0] = 0;                                                                    \
+                                                                                            \
+    for (size_t i = 1; i < m; i++) {                                                        \
+        /* внутри текущего z блока берем готовый ответ из начала строки, обрезая по r */   \
+        if (i < r) {                                                                        \
+            Z[i] = r - i < Z[i - l] ? r - i : Z[i - l];                                     \
+        } else {                                                                            \
+            Z[i] = 0;                                                                       \
+        }                                                                                   \
+                                                                                            \
+        /* расширяем общий префикс насколько это возможно */                               \
+        while (i + Z[i] < m && s[Z[i]] == s[i + Z[i]]) {                                    \
+            Z[i]++;                                                                         \
+        }                                                                                   \
+                                                                                            \
+        /* если нашли Z блок с большей правой границей - обновляем */                      \
+        if (i + Z[i] > r) {                                                                 \
+            l = i;                                                                          \
+            r = i + Z[i];                                                                   \
+        }                                                                                   \
+    }                                                                                       \
+                                                                                            \
+    return Z;                                                                               \
+}                                                                                           \
+                                                                                            \
+uint##bits##_t *preprocess##bits(uint32_t *p, size_t m) {                                   \
+    uint##bits##_t *Z = calcZ##bits(p, m);                                                  \
+    uint##bits##_t *SP = malloc(sizeof(uint##bits##_t) * m);                                \
+                                                                                            \
+    for (size_t i = 0; i < m; i++) {                                                        \
+        SP[i] = 0;                                                                          \
+    }                                                                                       \
+                                                                                            \
+    for (size_t j = m; j >= 2; j--) {                                                       \
+        size_t i = j + Z[j - 1] - 1;                                                        \
+        SP[i - 1] = Z[j - 1];                                                               \
+    }                                                                                       \
+                                                                                            \
+    free(Z);                                                                                \
+    return SP;                                                                              \
+}                                                                                           \
+                                                                                            \
+/* KMP по пачке; q - длина совпавшего префикса, offset - глобальный номер nums[0].      */ \
+/* Пока нет начатого совпадения, KMP просто идет вперед - перепрыгиваем к кандидату.       */ \
+void scanBatch##bits(const uint32_t *P, size_t m, const uint##bits##_t *SP,                 \
+    const uint32_t *nums, size_t n, size_t *q, size_t offset,                               \
+    OnTokenMatch onMatch, void *ctx) {                                                      \
+                                                                                            \
+    size_t matched = *q;                                                                    \
+                                                                                            \
+    for (size_t i = 0; i < n; i++) {                                                        \
+        if (USE_PREFILTER && matched == 0) {                                                \
+            i = findCandidate(P[0], P[m - 1], m, nums, n, i);                               \
+            if (i >= n) break;                                                              \
+        }                                                                                   \
+                                                                                            \
+        uint32_t num = nums[i];                                                             \
+                                                                                            \
+        while (matched > 0 && P[matched] != num) matched = SP[matched - 1];                 \
+        if (P[matched] == num) matched++;                                                   \
+                                                                                            \
+        if (matched == m) {                                                                 \
+            onMatch(ctx, offset + i + 1 - m);                                               \
+            matched = SP[m - 1];                                                            \
+        }                                                                                   \
+    }                                                                                       \
+                                                                                            \
+    *q = matched;                                                                           \
+}
+
+DEFINE_PREFIX_FUNCTIONS(16)
+DEFINE_PREFIX_FUNCTIONS(32)
+DEFINE_PREFIX_FUNCTIONS(64)
+
+typedef struct SPTable {
+    void *values;
+    int bits;
+} SPTable;
+
+SPTable preprocess(uint32_t *p, size_t m) {
+    SPTable res;
+
+    if (m <= (size_t)UINT16_MAX + 1) {
+        res.bits = 16;
+        res.values = preprocess16(p, m);
+    } else if (m <= (size_t)UINT32_MAX + 1) {
+        res.bits = 32;
+        res.values = preprocess32(p, m);
+    } else {
+        res.bits = 64;
+        res.values = preprocess64(p, m);
+    }
+
+    return res;
+}
+
+// ================ потоковый поиск ================
+//
+// Matcher ищет паттерн в потоке токенов, приходящем кусками произвольной длины:
+//
+//   Matcher matcher = createMatcher(P, m, onMatch, ctx);
+//   feedMatcher(matcher, tokens, count);   // сколько угодно раз
+//   deleteMatcher(matcher);
+//
+// Между кусками хранится только длина совпавшего префикса, поэтому
+// вхождения, разорванные границей куска, находятся без буферизации текста.
+// onMatch получает глобальный номер первого токена вхождения.
+// Паттерн не копируется и должен жить дольше Matcher.
+
+typedef struct Matcher {
+    const uint32_t *P;
+    size_t m;
+    SPTable SP;
+
+    size_t q;
+    size_t fed;
+
+    OnTokenMatch onMatch;
+    void *ctx;
+} _Matcher, *Matcher;
+
+Matcher createMatcher(const uint32_t *P, size_t m, OnTokenMatch onMatch, void *ctx) {
+    Matcher res = malloc(sizeof(_Matcher));
 
-            sequence[sequenceSize] = num;
-            sequenceSize++;
+    res->P = P;
+    res->m = m;
+    res->SP = preprocess((uint32_t*)P, m);
+    res->q = 0;
+    res->fed = 0;
+    res->onMatch = onMatch;
+    res->ctx = ctx;
+
+    return res;
+}
+
+void deleteMatcher(Matcher matcher) {
+    free(matcher->SP.values);
+    free(matcher);
+}
+
+// начать новый поток с тем же паттерном
+void resetMatcher(Matcher matcher) {
+    matcher->q = 0;
+    matcher->fed = 0;
+}
+
+void feedMatcher(Matcher matcher, const uint32_t *tokens, size_t count) {
+    if (matcher->m == 0) return;
+
+    const uint32_t *P = matcher->P;
+    size_t m = matcher->m;
+
+    switch (matcher->SP.bits) {
+        case 16:
+            scanBatch16(P, m, matcher->SP.values, tokens, count, &matcher->q, matcher->fed, matcher->onMatch, matcher->ctx);
             break;
-        }
+        case 32:
+            scanBatch32(P, m, matcher->SP.values, tokens, count, &matcher->q, matcher->fed, matcher->onMatch, matcher->ctx);
+            break;
+        default:
+            scanBatch64(P, m, matcher->SP.values, tokens, count, &matcher->q, matcher->fed, matcher->onMatch, matcher->ctx);
+    }
 
-        char c = symbol;
-        
-        if (c == ' ') {
-            if (!parseNum) continue;
-            parseNum = false;
-            
-            if (sequenceSize >= sequenceCap) {
-                sequence = realloc(sequence, sizeof(uint32_t) * (sequenceCap + EXTEND_SIZE));
-                sequenceCap += EXTEND_SIZE;
-            }
+    matcher->fed += count;
+}
+
+// ================ поиск с k несовпадениями ================
+//
+// ApproxMatcher сообщает о всех окнах текста длины m, отличающихся от паттерна
+// не более чем в k позициях. Интерфейс тот же, что у Matcher.
+//
+// Для каждого окна делаем "прыжки кенгуру": LCE (длина общего префикса
+// P[j..] и окна с позиции j) перепрыгивает совпавший кусок, затем одно
+// несовпадение, и так не больше k + 1 раз. LCE точный: на каждый кусок текста
+// строится суффиксный массив строки "паттерн, разделитель, буфер" (SA-IS),
+// LCP по Касаи и разреженная таблица минимумов над LCP. Тогда LCE - минимум
+// LCP между рангами двух суффиксов, O(1). Кусок из c токенов обходится в
+// O((m + c) log(m + c)) на построение (таблица и коды токенов) и O(ck) на прыжки;
+// короткие совпадения сравниваются напрямую, и пока их хватает, индекс не строится.
+//
+// Текст буферизуется: держим хвост из m - 1 токена, чтобы достроить окна
+// на границе кусков.
+
+// столько токенов сравниваем напрямую, прежде чем спрашивать LCP; на случайном
+// тексте дальше почти не доходит, и индекс куска так и не строится
+#define LCE_DIRECT 32
+#define EMPTY_SA UINT32_MAX
+
+// Суффиксный массив строки кодов: 0 - конец строки, 1 - разделитель, 2 - токен,
+// которого нет в паттерне, дальше - токены паттерна по возрастанию. Все токены не из
+// паттерна можно склеить в один код: совпадение с паттерном на них все равно кончается
+typedef struct LceIndex {
+    // различные токены паттерна по возрастанию и сам паттерн в кодах
+    uint32_t *values;
+    size_t valueCount;
+    uint32_t *patternCodes;
+
+    uint32_t *s;
+    uint32_t *sa;
+    uint32_t *rank;
+    // sparse[l * cap + r] - минимум lcp[r, r + 2^l)
+    uint32_t *sparse;
+    size_t n;
+    size_t cap;
+} LceIndex;
+
+typedef struct ApproxMatcher {
+    const uint32_t *P;
+    size_t m;
+    size_t k;
+
+    // буфер текста: buf[0] имеет глобальный номер bufOffset
+    uint32_t *buf;
+    size_t bufSize;
+    size_t bufCap;
+    size_t bufOffset;
+
+    LceIndex lce;
+    // индекс построен по текущему буферу
+    bool lceReady;
+
+    OnTokenMatch onMatch;
+    void *ctx;
+} _ApproxMatcher, *ApproxMatcher;
+
+static int cmpToken(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// код токена: двоичный поиск среди токенов паттерна
+static uint32_t tokenCode(const LceIndex *lce, uint32_t token) {
+    size_t lo = 0;
+    size_t hi = lce->valueCount;
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (lce->values[mid] < token) lo = mid + 1;
+        else hi = mid;
+    }
+
+    return lo < lce->valueCount && lce->values[lo] == token ? lo + 3 : 2;
+}
 
-            sequence[sequenceSize] = num;
-            sequenceSize++;
-            num = 0;
+ApproxMatcher createApproxMatcher(const uint32_t *P, size_t m, size_t k, OnTokenMatch onMatch, void *ctx) {
+    ApproxMatcher res = malloc(sizeof(_ApproxMatcher));
+
+    res->P = P;
+    res->m = m;
+    res->k = k;
+
+    res->bufCap = BATCH_SIZE;
+    res->buf = malloc(sizeof(uint32_t) * res->bufCap);
+    res->bufSize = 0;
+    res->bufOffset = 0;
+
+    LceIndex *lce = &res->lce;
+    memset(lce, 0, sizeof(LceIndex));
+    res->lceReady = false;
+
+    lce->values = malloc(sizeof(uint32_t) * (m > 0 ? m : 1));
+    memcpy(lce->values, P, sizeof(uint32_t) * m);
+    qsort(lce->values, m, sizeof(uint32_t), cmpToken);
+    for (size_t i = 0; i < m; i++) {
+        if (i == 0 || lce->values[i] != lce->values[lce->valueCount - 1]) lce->values[lce->valueCount++] = lce->values[i];
+    }
+
+    lce->patternCodes = malloc(sizeof(uint32_t) * (m > 0 ? m : 1));
+    for (size_t i = 0; i < m; i++) lce->patternCodes[i] = tokenCode(lce, P[i]);
+
+    res->onMatch = onMatch;
+    res->ctx = ctx;
+
+    return res;
+}
+
+void deleteApproxMatcher(ApproxMatcher matcher) {
+    LceIndex *lce = &matcher->lce;
+    free(lce->values);
+    free(lce->patternCodes);
+    free(lce->s);
+    free(lce->sa);
+    free(lce->rank);
+    free(lce->sparse);
+
+    free(matcher->buf);
+    free(matcher);
+}
+
+static int levelsFor(size_t n) {
+    int levels = 1;
+    while (((size_t)1 << levels) <= n) levels++;
+    return levels;
+}
+
+// SA-IS, как в lab5: s[n - 1] = 0 - единственный минимальный символ, остальные из [1, K)
+static void bucketsSA(const uint32_t *s, size_t n, size_t K, size_t *buckets, bool end) {
+    memset(buckets, 0, sizeof(size_t) * K);
+    for (size_t i = 0; i < n; i++) buckets[s[i]]++;
+
+    size_t sum = 0;
+    for (size_t c = 0; c < K; c++) {
+        sum += buckets[c];
+        buckets[c] = end ? sum : sum - buckets[c];
+    }
+}
+
+static void induceSA(const uint32_t *s, uint32_t *SA, const bool *isS, size_t n, size_t K, size_t *buckets) {
+    bucketsSA(s, n, K, buckets, false);
+    for (size_t i = 0; i < n; i++) {
+        if (SA[i] == EMPTY_SA || SA[i] == 0) continue;
+        size_t j = SA[i] - 1;
+        if (!isS[j]) SA[buckets[s[j]]++] = j;
+    }
+
+    bucketsSA(s, n, K, buckets, true);
+    for (size_t i = n; i-- > 0;) {
+        if (SA[i] == EMPTY_SA || SA[i] == 0) continue;
+        size_t j = SA[i] - 1;
+        if (isS[j]) SA[--buckets[s[j]]] = j;
+    }
+}
+
+static void sais(const uint32_t *s, uint32_t *SA, size_t n, size_t K) {
+    bool *isS = malloc(sizeof(bool) * n);
+    size_t *buckets = malloc(sizeof(size_t) * K);
+
+    isS[n - 1] = true;
+    for (size_t i = n - 1; i-- > 0;) {
+        isS[i] = s[i] < s[i + 1] || (s[i] == s[i + 1] && isS[i + 1]);
+    }
+
+    #define IS_LMS(i) ((i) > 0 && isS[i] && !isS[(i) - 1])
+
+    // 1. сортируем LMS-подстроки индукцией от грубо расставленных LMS
+    bucketsSA(s, n, K, buckets, true);
+    for (size_t i = 0; i < n; i++) SA[i] = EMPTY_SA;
+    for (size_t i = 1; i < n; i++) {
+        if (IS_LMS(i)) SA[--buckets[s[i]]] = i;
+    }
+    induceSA(s, SA, isS, n, K, buckets);
+
+    // 2. именуем LMS-подстроки, одинаковые получают одно имя
+    size_t n1 = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (SA[i] != EMPTY_SA && IS_LMS(SA[i])) SA[n1++] = SA[i];
+    }
+
+    for (size_t i = n1; i < n; i++) SA[i] = EMPTY_SA;
+
+    size_t name = 0;
+    size_t prev = EMPTY_SA;
+    for (size_t i = 0; i < n1; i++) {
+        size_t pos = SA[i];
+        bool diff = prev == EMPTY_SA;
+
+        for (size_t d = 0; !diff; d++) {
+            if (s[pos + d] != s[prev + d] || isS[pos + d] != isS[prev + d]) diff = true;
+            else if (d > 0 && (IS_LMS(pos + d) || IS_LMS(prev + d))) break;
         }
 
-        if ('0' <= c && c <= '9') {
-            parseNum = true;
-            num *= 10;
-            num += c - '0';
+        if (diff) {
+            name++;
+            prev = pos;
         }
+        SA[n1 + pos / 2] = name - 1;
     }
 
-    *size = sequenceSize;
-    return sequence;
+    for (size_t i = n, j = n; i-- > n1;) {
+        if (SA[i] != EMPTY_SA) SA[--j] = SA[i];
+    }
+
+    // 3. сортируем LMS-суффиксы: рекурсивно, если имена повторяются
+    uint32_t *s1 = SA + n - n1;
+    if (name < n1) {
+        sais(s1, SA, n1, name);
+    } else {
+        for (size_t i = 0; i < n1; i++) SA[s1[i]] = i;
+    }
+
+    // 4. расставляем LMS-суффиксы по порядку и индуцируем остальные
+    for (size_t i = 1, j = 0; i < n; i++) {
+        if (IS_LMS(i)) s1[j++] = i;
+    }
+    for (size_t i = 0; i < n1; i++) SA[i] = s1[SA[i]];
+    for (size_t i = n1; i < n; i++) SA[i] = EMPTY_SA;
+
+    bucketsSA(s, n, K, buckets, true);
+    for (size_t i = n1; i-- > 0;) {
+        uint32_t j = SA[i];
+        SA[i] = EMPTY_SA;
+        SA[--buckets[s[j]]] = j;
+    }
+    induceSA(s, SA, isS, n, K, buckets);
+
+    #undef IS_LMS
+
+    free(isS);
+    free(buckets);
 }
 
-uint16_t *calcZ(uint32_t *s, size_t m) {
-    uint16_t *Z = malloc(sizeof(uint16_t) * m);
+// строит суффиксный массив, LCP и таблицу минимумов над P, разделитель, T[0, t), конец
+static void buildLceIndex(LceIndex *lce, size_t m, const uint32_t *T, size_t t) {
+    size_t n = m + t + 2;
 
-    size_t l = 0;
-    size_t r = 0;
-    
-    Z[0] = 0;
-    
-    for (size_t i = 1; i < m; i++) {
-        if (i < r) {
-            // если мы в пределах текущего z блока, переходим к решению задачи в начале строки
-            // если значение длина строки B не превосходит Z функции в соответствующем индексе,
-            // строка B целиком совпадает, а дальше заканчивается Z блок, поэтому там точно нет совпадения
-            // в противном случае, совпадает по меньшей мере количество букв, равное Z функции
-            Z[i] = r - i < Z[i - l] ? r - i : Z[i - l];
-        } else {
-            // если нет - такова се ля ви, считаем по определению 
-            Z[i] = 0;
+    if (n > lce->cap) {
+        lce->cap = n * 2;
+        lce->s = realloc(lce->s, sizeof(uint32_t) * lce->cap);
+        lce->sa = realloc(lce->sa, sizeof(uint32_t) * lce->cap);
+        lce->rank = realloc(lce->rank, sizeof(uint32_t) * lce->cap);
+        lce->sparse = realloc(lce->sparse, sizeof(uint32_t) * lce->cap * levelsFor(lce->cap));
+    }
+    lce->n = n;
+
+    uint32_t *s = lce->s;
+    uint32_t *sa = lce->sa;
+    uint32_t *rank = lce->rank;
+
+    memcpy(s, lce->patternCodes, sizeof(uint32_t) * m);
+    s[m] = 1;
+    for (size_t i = 0; i < t; i++) s[m + 1 + i] = tokenCode(lce, T[i]);
+    s[n - 1] = 0;
+
+    sais(s, sa, n, lce->valueCount + 3);
+    for (size_t r = 0; r < n; r++) rank[sa[r]] = r;
+
+    // Касаи: lcp[r] - общий префикс суффиксов sa[r - 1] и sa[r]
+    uint32_t *lcp = lce->sparse;
+    lcp[0] = 0;
+    size_t h = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (rank[i] == 0) {
+            h = 0;
+            continue;
         }
 
-        // расширяем общий префикс насколько это возможно
-        while (i + Z[i] < m && s[Z[i]] == s[i + Z[i]]) {
-            Z[i]++;
+        size_t j = sa[rank[i] - 1];
+        while (s[i + h] == s[j + h]) h++;
+        lcp[rank[i]] = h;
+        if (h > 0) h--;
+    }
+
+    for (int l = 1; ((size_t)1 << l) <= n; l++) {
+        uint32_t *prev = lce->sparse + (l - 1) * lce->cap;
+        uint32_t *cur = lce->sparse + l * lce->cap;
+        size_t half = (size_t)1 << (l - 1);
+
+        for (size_t r = 0; r + 2 * half <= n; r++) {
+            cur[r] = prev[r] < prev[r + half] ? prev[r] : prev[r + half];
         }
-        
-        // если нашли Z блок с большей правой границей - обновляем
-        if (i + Z[i] > r) {
-            l = i;
-            r = i + Z[i];
+    }
+}
+
+// длина общего префикса суффиксов a != b
+static size_t queryLce(const LceIndex *lce, size_t a, size_t b) {
+    size_t lo = lce->rank[a];
+    size_t hi = lce->rank[b];
+    if (lo > hi) {
+        size_t swap = lo;
+        lo = hi;
+        hi = swap;
+    }
+
+    // минимум lcp(lo, hi]
+    lo++;
+    int l = 63 - __builtin_clzll(hi - lo + 1);
+    const uint32_t *level = lce->sparse + l * lce->cap;
+    uint32_t x = level[lo];
+    uint32_t y = level[hi + 1 - ((size_t)1 << l)];
+
+    return x < y ? x : y;
+}
+
+// длина общего префикса P[j..j + limit) и buf[s..s + limit)
+size_t approxLce(ApproxMatcher matcher, size_t j, size_t s, size_t limit) {
+    const uint32_t *P = matcher->P;
+    const uint32_t *T = matcher->buf;
+
+    size_t lo = 0;
+    while (lo < limit && lo < LCE_DIRECT) {
+        if (P[j + lo] != T[s + lo]) return lo;
+        lo++;
+    }
+    if (lo == limit) return lo;
+
+    if (!matcher->lceReady) {
+        buildLceIndex(&matcher->lce, matcher->m, matcher->buf, matcher->bufSize);
+        matcher->lceReady = true;
+    }
+
+    size_t res = queryLce(&matcher->lce, j, matcher->m + 1 + s);
+    return res < limit ? res : limit;
+}
+
+// проверяет окна, ставшие полными после добавления count токенов
+static void scanApproxChunk(ApproxMatcher matcher, const uint32_t *tokens, size_t count) {
+    size_t m = matcher->m;
+    size_t k = matcher->k;
+
+    // от прошлого куска нужен только хвост из m - 1 токена
+    if (matcher->bufSize >= m) {
+        size_t drop = matcher->bufSize - (m - 1);
+        memmove(matcher->buf, matcher->buf + drop, sizeof(uint32_t) * (m - 1));
+        matcher->bufOffset += drop;
+        matcher->bufSize = m - 1;
+    }
+
+    if (matcher->bufSize + count > matcher->bufCap) {
+        matcher->bufCap = (matcher->bufSize + count) * 2;
+        matcher->buf = realloc(matcher->buf, sizeof(uint32_t) * matcher->bufCap);
+    }
+
+    memcpy(matcher->buf + matcher->bufSize, tokens, sizeof(uint32_t) * count);
+    matcher->bufSize += count;
+    if (matcher->bufSize < m) return;
+
+    // индекс по новому буферу строится при первом длинном совпадении
+    matcher->lceReady = false;
+
+    for (size_t s = 0; s + m <= matcher->bufSize; s++) {
+        size_t j = 0;
+        size_t errors = 0;
+
+        while (true) {
+            j += approxLce(matcher, j, s + j, m - j);
+            if (j >= m) break;
+            if (++errors > k) break;
+            j++;
         }
+
+        if (errors <= k) matcher->onMatch(matcher->ctx, matcher->bufOffset + s);
     }
+}
+
+void feedApproxMatcher(ApproxMatcher matcher, const uint32_t *tokens, size_t count) {
+    size_t m = matcher->m;
+    if (m == 0) return;
 
-    return Z;
+    // индекс строится на кусок, поэтому длинный вход режем: не меньше m новых
+    // токенов на кусок, чтобы построение окупалось, и не больше, чтобы не раздувать память
+    size_t chunk = m > BATCH_SIZE ? m : BATCH_SIZE;
+
+    for (size_t from = 0; from < count; from += chunk) {
+        scanApproxChunk(matcher, tokens + from, count - from < chunk ? count - from : chunk);
+    }
 }
 
-uint16_t *preprocess(uint32_t *p, size_t m) {
-    uint16_t *Z = calcZ(p, m);
+// позиции последних keep токенов. Токены одной строки идут подряд,
+// поэтому храним отрезки: первый токен отрезка, его строка и номер в строке
+typedef struct History {
+    size_t *starts;
+    int64_t *lines;
+    size_t *indexes;
+    size_t head;
+    size_t size;
+    size_t cap;
+    size_t keep;
+} History;
 
-    uint16_t *SP = malloc(sizeof(uint16_t) * m);
-    
-    for (size_t i = 0; i < m; i++) {
-        SP[i] = 0;
+History createHistory(size_t keep) {
+    History res;
+
+    res.cap = 16;
+    res.starts = malloc(sizeof(size_t) * res.cap);
+    res.lines = malloc(sizeof(int64_t) * res.cap);
+    res.indexes = malloc(sizeof(size_t) * res.cap);
+    res.head = 0;
+    res.size = 0;
+    res.keep = keep;
+
+    return res;
+}
+
+void deleteHistory(History *history) {
+    free(history->starts);
+    free(history->lines);
+    free(history->indexes);
+}
+
+void extendHistory(History *history) {
+    size_t newCap = history->cap * 2;
+    size_t *starts = malloc(sizeof(size_t) * newCap);
+    int64_t *lines = malloc(sizeof(int64_t) * newCap);
+    size_t *indexes = malloc(sizeof(size_t) * newCap);
+
+    for (size_t i = 0; i < history->size; i++) {
+        size_t slot = (history->head + i) % history->cap;
+        starts[i] = history->starts[slot];
+        lines[i] = history->lines[slot];
+        indexes[i] = history->indexes[slot];
     }
 
-    for (size_t j = m; j >= 2; j--) {
-        size_t i = j + Z[j - 1] - 1;
-        SP[i - 1] = Z[j - 1];
+    deleteHistory(history);
+    history->starts = starts;
+    history->lines = lines;
+    history->indexes = indexes;
+    history->head = 0;
+    history->cap = newCap;
+}
+
+// запоминаем позиции хвоста пачки, начинающейся с глобального номера offset
+void rememberTail(History *history, Tokens *batch, size_t offset) {
+    size_t keep = history->keep < batch->size ? history->keep : batch->size;
+
+    for (size_t j = batch->size - keep; j < batch->size; j++) {
+        if (history->size > 0) {
+            size_t last = (history->head + history->size - 1) % history->cap;
+            size_t expected = history->indexes[last] + (offset + j - history->starts[last]);
+            if (history->lines[last] == batch->lines[j] && expected == batch->indexes[j]) continue;
+        }
+
+        if (history->size >= history->cap) extendHistory(history);
+
+        size_t slot = (history->head + history->size) % history->cap;
+        history->starts[slot] = offset + j;
+        history->lines[slot] = batch->lines[j];
+        history->indexes[slot] = batch->indexes[j];
+        history->size++;
+    }
+
+    // выкидываем отрезки, целиком ушедшие за окно
+    size_t end = offset + batch->size;
+    size_t oldest = end > history->keep ? end - history->keep : 0;
+
+    while (history->size >= 2 && history->starts[(history->head + 1) % history->cap] <= oldest) {
+        history->head = (history->head + 1) % history->cap;
+        history->size--;
+    }
+}
+
+// позиция токена с глобальным номером index: из текущей пачки или из истории
+void positionOf(Tokens *batch, History *history, size_t offset, size_t index, int64_t *line, size_t *lineIndex) {
+    if (index >= offset) {
+        *line = batch->lines[index - offset];
+        *lineIndex = batch->indexes[index - offset];
+        return;
+    }
+
+    // последний отрезок, начинающийся не позже index
+    size_t lo = 0;
+    size_t hi = history->size;
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (history->starts[(history->head + mid) % history->cap] <= index) lo = mid;
+        else hi = mid;
+    }
+
+    size_t slot = (history->head + lo) % history->cap;
+    *line = history->lines[slot];
+    *lineIndex = history->indexes[slot] + (index - history->starts[slot]);
+}
+
+typedef void (*OnMatch)(void *ctx, int64_t line, size_t lineIndex);
+
+void printMatch(void *ctx, int64_t line, size_t lineIndex) {
+    (void)ctx;
+    printf("%ld, %lu\n", line + 1, lineIndex + 1);
+}
+
+// переводит номер токена в строку и позицию для обертки над Matcher
+typedef struct TokenSearch {
+    Tokens *batch;
+    History *history;
+    size_t offset;
+    size_t maxStart;
+
+    OnMatch onMatch;
+    void *ctx;
+} TokenSearch;
+
+void reportPosition(void *arg, size_t start) {
+    TokenSearch *search = arg;
+    if (start >= search->maxStart) return;
+
+    int64_t line;
+    size_t lineIndex;
+    positionOf(search->batch, search->history, search->offset, start, &line, &lineIndex);
+    search->onMatch(search->ctx, line, lineIndex);
+}
+
+// разбирает не больше maxTokens токенов и сообщает о вхождениях,
+// которые начинаются среди первых maxStart из них
+void searchTokens(uint32_t *P, size_t m, TextReader reader,
+    size_t maxTokens, size_t maxStart, OnMatch onMatch, void *ctx) {
+
+    if (m == 0) return;
+
+    Tokens batch = createTokens(BATCH_SIZE);
+    History history = createHistory(m - 1);
+    TokenSearch search = {&batch, &history, 0, maxStart, onMatch, ctx};
+    Matcher matcher = createMatcher(P, m, reportPosition, &search);
+
+    while (search.offset < maxTokens) {
+        size_t want = maxTokens - search.offset < BATCH_SIZE ? maxTokens - search.offset : BATCH_SIZE;
+        if (readTokens(reader, &batch, want, false) == 0) break;
+
+        feedMatcher(matcher, batch.nums, batch.size);
+
+        rememberTail(&history, &batch, search.offset);
+        search.offset += batch.size;
     }
 
-    free(Z);
+    deleteMatcher(matcher);
+    deleteHistory(&history);
+    deleteTokens(&batch);
+}
 
-    return SP;
+void search(uint32_t *P, size_t m, TextReader reader) {
+    searchTokens(P, m, reader, SIZE_MAX, SIZE_MAX, printMatch, NULL);
 }
 
-void search(uint32_t *P, size_t m, uint16_t *SP) {
+// то же, что searchTokens, но вхождения с не более чем k несовпадениями
+void searchApprox(uint32_t *P, size_t m, size_t k, TextReader reader, OnMatch onMatch, void *ctx) {
     if (m == 0) return;
 
-    size_t c = 1;
-    size_t p = 1;
+    Tokens batch = createTokens(BATCH_SIZE);
+    History history = createHistory(m - 1);
+    TokenSearch search = {&batch, &history, 0, SIZE_MAX, onMatch, ctx};
+    ApproxMatcher matcher = createApproxMatcher(P, m, k, reportPosition, &search);
+
+    while (readTokens(reader, &batch, BATCH_SIZE, false) > 0) {
+        feedApproxMatcher(matcher, batch.nums, batch.size);
+
+        rememberTail(&history, &batch, search.offset);
+        search.offset += batch.size;
+    }
+
+    deleteApproxMatcher(matcher);
+    deleteHistory(&history);
+    deleteTokens(&batch);
+}
+
+// ================ параллельный поиск по отображенному в память файлу ================
+
+typedef struct Matches {
+    int64_t *lines;
+    size_t *indexes;
+    size_t size;
+    size_t cap;
+} Matches;
+
+void collectMatch(void *ctx, int64_t line, size_t lineIndex) {
+    Matches *matches = ctx;
+
+    if (matches->size >= matches->cap) {
+        matches->cap = matches->cap * 2 + 16;
+        matches->lines = realloc(matches->lines, sizeof(int64_t) * matches->cap);
+        matches->indexes = realloc(matches->indexes, sizeof(size_t) * matches->cap);
+    }
+
+    matches->lines[matches->size] = line;
+    matches->indexes[matches->size] = lineIndex;
+    matches->size++;
+}
+
+// кусок текста [begin, end), границы стоят сразу после разделителей
+typedef struct Chunk {
+    uint32_t *P;
+    size_t m;
+
+    const char *data;
+    size_t begin;
+    size_t end;
+    size_t fileEnd;
+
+    // первый проход: сколько в куске токенов, переводов строк и токенов после последнего перевода
+    size_t tokenCount;
+    size_t newlines;
+    size_t trailing;
+
+    // второй проход: позиция первого токена куска
+    size_t startLine;
+    size_t startIndex;
+    Matches matches;
+} Chunk;
+
+void *countChunk(void *arg) {
+    Chunk *chunk = arg;
+    TextReader reader = createMemoryReader(chunk->data + chunk->begin, chunk->end - chunk->begin);
+    Tokens batch = createTokens(BATCH_SIZE);
+
+    chunk->tokenCount = 0;
+    while (readTokens(reader, &batch, BATCH_SIZE, false) > 0) {
+        chunk->tokenCount += batch.size;
+    }
+
+    chunk->newlines = reader->lineNum;
+    chunk->trailing = reader->lineIndex;
+
+    deleteTokens(&batch);
+    deleteTextReader(reader);
+    return NULL;
+}
+
+// ищем вхождения, начинающиеся в куске, заходя в следующие куски на m - 1 токен
+void *searchChunk(void *arg) {
+    Chunk *chunk = arg;
+    TextReader reader = createMemoryReader(chunk->data + chunk->begin, chunk->fileEnd - chunk->begin);
+
+    reader->lineNum = chunk->startLine;
+    reader->lineIndex = chunk->startIndex;
+
+    searchTokens(chunk->P, chunk->m, reader, chunk->tokenCount + chunk->m - 1,
+        chunk->tokenCount, collectMatch, &chunk->matches);
+
+    deleteTextReader(reader);
+    return NULL;
+}
+
+void runChunks(Chunk *chunks, int threads, void *(*job)(void*)) {
+    pthread_t *ids = malloc(sizeof(pthread_t) * threads);
+    bool *started = malloc(sizeof(bool) * threads);
+
+    for (int t = 1; t < threads; t++) {
+        started[t] = pthread_create(&ids[t], NULL, job, &chunks[t]) == 0;
+        if (!started[t]) job(&chunks[t]);
+    }
+
+    job(&chunks[0]);
+
+    for (int t = 1; t < threads; t++) {
+        if (started[t]) pthread_join(ids[t], NULL);
+    }
+
+    free(ids);
+    free(started);
+}
+
+// text - весь вход вместе со строкой паттерна
+void parallelSearch(const char *text, size_t size, int threads) {
+    TextReader reader = createMemoryReader(text, size);
+
+    size_t m;
+    uint32_t *P = readSequence(reader, &m);
+    size_t textBegin = reader->blockPos;
+
+    deleteTextReader(reader);
+
+    Chunk *chunks = malloc(sizeof(Chunk) * threads);
+    size_t prevEnd = textBegin;
+
+    for (int t = 0; t < threads; t++) {
+        size_t end = textBegin + (size - textBegin) * (t + 1) / threads;
+        if (end < prevEnd) end = prevEnd;
+        // не режем число: граница - сразу после разделителя
+        while (end < size && text[end - 1] != ' ' && text[end - 1] != '\n') end++;
+
+        Chunk chunk = {P, m, text, prevEnd, end, size, 0, 0, 0, 0, 0, {NULL, NULL, 0, 0}};
+        chunks[t] = chunk;
+        prevEnd = end;
+    }
+
+    runChunks(chunks, threads, countChunk);
+
+    // префиксные суммы: номер строки и номер в строке первого токена каждого куска
+    for (int t = 1; t < threads; t++) {
+        Chunk *prev = &chunks[t - 1];
+        chunks[t].startLine = prev->startLine + prev->newlines;
+        chunks[t].startIndex = prev->newlines > 0 ? prev->trailing : prev->startIndex + prev->trailing;
+    }
+
+    runChunks(chunks, threads, searchChunk);
+
+    for (int t = 0; t < threads; t++) {
+        Matches *matches = &chunks[t].matches;
+        for (size_t i = 0; i < matches->size; i++) {
+            printMatch(NULL, matches->lines[i], matches->indexes[i]);
+        }
+
+        free(matches->lines);
+        free(matches->indexes);
+    }
+
+    free(chunks);
+    free(P);
+}
+
+// ================ бинарный формат текста ================
+//
+// Один и тот же текст можно один раз перевести в бинарный вид (-c) и дальше
+// искать в нем, отображая файл в память (-b), без разбора десятичных чисел.
+//
+// Файл: заголовок, поток токенов, таблица блоков, таблица строк.
+// Токены разбиты на блоки по BATCH_SIZE. В блоке каждый токен записан как
+// zigzag-разность с предыдущим в varint (LEB128), перед блоком предыдущий = 0.
+// blocks[b] - смещение блока b в потоке, blocks[blockCount] - конец потока.
+// lineStarts[l] - номер первого токена, стоящего не раньше начала строки l.
 
-    TextReader reader = createTextReader(m);
+#define CORPUS_MAGIC "LAB4TOK1"
+// varint для uint32 занимает не больше 5 байт
+#define VARINT_MAX 5
 
-    while (!feof(stdin)) {
-        while (p <= m && P[p - 1] == getNum(reader, c - 1).num && 
-            getNum(reader, c - 1).line != -1) {
-                
-            p++;
-            c++;
+typedef struct CorpusHeader {
+    char magic[8];
+    uint64_t tokenCount;
+    uint64_t lineCount;
+    uint64_t blockCount;
+    uint64_t dataOffset;
+    uint64_t blocksOffset;
+    uint64_t linesOffset;
+} CorpusHeader;
+
+static inline size_t writeVarint(uint8_t *out, uint32_t value) {
+    size_t len = 0;
+
+    while (value >= 0x80) {
+        out[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[len++] = (uint8_t)value;
+
+    return len;
+}
+
+static inline uint32_t zigzag(uint32_t cur, uint32_t prev) {
+    int32_t delta = (int32_t)(cur - prev);
+    return ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+}
+
+// весь reader - текст без строки паттерна; false при ошибке записи
+bool convertText(TextReader reader, FILE *out) {
+    CorpusHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CORPUS_MAGIC, sizeof(header.magic));
+    header.dataOffset = sizeof(CorpusHeader);
+
+    if (fwrite(&header, sizeof(header), 1, out) != 1) return false;
+
+    Tokens batch = createTokens(BATCH_SIZE);
+    uint8_t *encoded = malloc(VARINT_MAX * BATCH_SIZE);
+
+    size_t blocksCap = 16;
+    uint64_t *blocks = malloc(sizeof(uint64_t) * blocksCap);
+    size_t linesCap = 16;
+    uint64_t *lineStarts = malloc(sizeof(uint64_t) * linesCap);
+
+    uint64_t dataSize = 0;
+    bool ok = true;
+
+    while (ok && readTokens(reader, &batch, BATCH_SIZE, false) > 0) {
+        if (header.blockCount + 1 >= blocksCap) {
+            blocksCap *= 2;
+            blocks = realloc(blocks, sizeof(uint64_t) * blocksCap);
         }
-        
-        if (p == m + 1) {
-            Num num = getNum(reader, c - m - 1);
-            printf("%ld, %lu\n", num.line + 1, num.index + 1);
-        } 
+        blocks[header.blockCount++] = dataSize;
+
+        size_t len = 0;
+        uint32_t prev = 0;
+
+        for (size_t i = 0; i < batch.size; i++) {
+            len += writeVarint(encoded + len, zigzag(batch.nums[i], prev));
+            prev = batch.nums[i];
+
+            // начала всех строк до строки этого токена включительно
+            while (header.lineCount <= (uint64_t)batch.lines[i]) {
+                if (header.lineCount >= linesCap) {
+                    linesCap *= 2;
+                    lineStarts = realloc(lineStarts, sizeof(uint64_t) * linesCap);
+                }
+                lineStarts[header.lineCount++] = header.tokenCount + i;
+            }
+        }
+
+        ok = fwrite(encoded, 1, len, out) == len;
+        dataSize += len;
+        header.tokenCount += batch.size;
+    }
+
+    blocks[header.blockCount] = dataSize;
+
+    // таблицы выравниваем на 8 байт, чтобы читать их прямо из отображения
+    uint64_t padding = (8 - dataSize % 8) % 8;
+    uint8_t zeros[8] = {0};
+
+    header.blocksOffset = header.dataOffset + dataSize + padding;
+    header.linesOffset = header.blocksOffset + sizeof(uint64_t) * (header.blockCount + 1);
+
+    ok = ok && fwrite(zeros, 1, padding, out) == padding;
+    ok = ok && fwrite(blocks, sizeof(uint64_t), header.blockCount + 1, out) == header.blockCount + 1;
+    ok = ok && fwrite(lineStarts, sizeof(uint64_t), header.lineCount, out) == header.lineCount;
+    ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, out) == 1;
+
+    free(blocks);
+    free(lineStarts);
+    free(encoded);
+    deleteTokens(&batch);
+
+    return ok;
+}
+
+typedef struct Corpus {
+    const uint8_t *map;
+    size_t mapSize;
+
+    const CorpusHeader *header;
+    const uint8_t *data;
+    const uint64_t *blocks;
+    const uint64_t *lineStarts;
+} _Corpus, *Corpus;
+
+// NULL, если файл не открылся или это не бинарный текст
+Corpus openCorpus(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return NULL;
+
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fileno(file), &st) == 0 && (size_t)st.st_size >= sizeof(CorpusHeader)) {
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    }
+    fclose(file);
+
+    if (map == MAP_FAILED) return NULL;
+
+    const CorpusHeader *header = map;
+    uint64_t size = st.st_size;
+
+    bool valid = memcmp(header->magic, CORPUS_MAGIC, sizeof(header->magic)) == 0
+        && header->blocksOffset % 8 == 0 && header->blocksOffset <= size
+        && header->blockCount < (size - header->blocksOffset) / sizeof(uint64_t)
+        && header->linesOffset == header->blocksOffset + sizeof(uint64_t) * (header->blockCount + 1)
+        && header->lineCount <= (size - header->linesOffset) / sizeof(uint64_t)
+        && header->dataOffset <= header->blocksOffset;
+
+    if (valid) {
+        const uint64_t *blocks = (const uint64_t*)((const uint8_t*)map + header->blocksOffset);
+        valid = blocks[header->blockCount] <= header->blocksOffset - header->dataOffset
+            && header->tokenCount <= header->blockCount * (uint64_t)BATCH_SIZE
+            && (header->tokenCount == 0 || header->lineCount > 0);
+
+        for (uint64_t b = 0; valid && b < header->blockCount; b++) valid = blocks[b] <= blocks[b + 1];
+
+        // corpusPosition ищет по строкам двоичным поиском и вычитает начало строки:
+        // начала должны идти с нуля, не убывать и не выходить за число токенов
+        const uint64_t *lineStarts = (const uint64_t*)((const uint8_t*)map + header->linesOffset);
+        valid = valid && (header->lineCount == 0 || lineStarts[0] == 0);
+        for (uint64_t l = 1; valid && l < header->lineCount; l++) valid = lineStarts[l - 1] <= lineStarts[l];
+        valid = valid && (header->lineCount == 0 || lineStarts[header->lineCount - 1] <= header->tokenCount);
+    }
+
+    if (!valid) {
+        munmap(map, st.st_size);
+        return NULL;
+    }
+
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    Corpus res = malloc(sizeof(_Corpus));
+
+    res->map = map;
+    res->mapSize = st.st_size;
+    res->header = header;
+    res->data = res->map + header->dataOffset;
+    res->blocks = (const uint64_t*)(res->map + header->blocksOffset);
+    res->lineStarts = (const uint64_t*)(res->map + header->linesOffset);
+
+    return res;
+}
 
-        if (p == 1) {
-            c++;
-        } else {
-            p = SP[p - 2] + 1;
+void closeCorpus(Corpus corpus) {
+    munmap((void*)corpus->map, corpus->mapSize);
+    free(corpus);
+}
+
+// распаковывает блок b в out (не больше BATCH_SIZE токенов), возвращает их число
+size_t decodeBlock(Corpus corpus, uint64_t b, uint32_t *out) {
+    const uint8_t *pos = corpus->data + corpus->blocks[b];
+    const uint8_t *end = corpus->data + corpus->blocks[b + 1];
+
+    uint64_t first = b * BATCH_SIZE;
+    uint64_t left = corpus->header->tokenCount - first;
+    size_t count = left < BATCH_SIZE ? left : BATCH_SIZE;
+
+    uint32_t prev = 0;
+    size_t n = 0;
+
+    while (n < count && pos < end) {
+        uint32_t value = *pos & 0x7f;
+        int shift = 7;
+
+        while ((*pos++ & 0x80) && pos < end && shift < 35) {
+            value |= (uint32_t)(*pos & 0x7f) << shift;
+            shift += 7;
         }
+
+        prev += (value >> 1) ^ -(value & 1);
+        out[n++] = prev;
+    }
+
+    return n;
+}
+
+// строка и позиция в строке токена с глобальным номером index
+void corpusPosition(Corpus corpus, uint64_t index, int64_t *line, size_t *lineIndex) {
+    // последняя строка, начинающаяся не позже index
+    uint64_t lo = 0;
+    uint64_t hi = corpus->header->lineCount;
+    while (hi - lo > 1) {
+        uint64_t mid = (lo + hi) / 2;
+        if (corpus->lineStarts[mid] <= index) lo = mid;
+        else hi = mid;
+    }
+
+    *line = lo;
+    *lineIndex = index - corpus->lineStarts[lo];
+}
+
+typedef struct CorpusSearch {
+    Corpus corpus;
+    OnMatch onMatch;
+    void *ctx;
+} CorpusSearch;
+
+void reportCorpusPosition(void *arg, size_t start) {
+    CorpusSearch *search = arg;
+
+    int64_t line;
+    size_t lineIndex;
+    corpusPosition(search->corpus, start, &line, &lineIndex);
+    search->onMatch(search->ctx, line, lineIndex);
+}
+
+void searchCorpus(uint32_t *P, size_t m, Corpus corpus, OnMatch onMatch, void *ctx) {
+    if (m == 0) return;
+
+    CorpusSearch search = {corpus, onMatch, ctx};
+    Matcher matcher = createMatcher(P, m, reportCorpusPosition, &search);
+    uint32_t *nums = malloc(sizeof(uint32_t) * BATCH_SIZE);
+
+    for (uint64_t b = 0; b < corpus->header->blockCount; b++) {
+        size_t count = decodeBlock(corpus, b, nums);
+        feedMatcher(matcher, nums, count);
+    }
+
+    free(nums);
+    deleteMatcher(matcher);
+}
+
+#define NO_NODE UINT32_MAX
+#define NO_PATTERN SIZE_MAX
+#define ROOT 0
+#define EMPTY_KEY UINT64_MAX
+
+// автомат Ахо-Корасик над алфавитом uint32
+typedef struct Automaton {
+    // переходы: открытая адресация, ключ - (вершина << 32) | символ
+    uint64_t *keys;
+    uint32_t *values;
+    size_t tableCap;
+    size_t edgeCount;
+
+    // дети вершины списком - нужны только для обхода в ширину при построении
+    uint32_t *firstChild;
+    uint32_t *nextSibling;
+    uint32_t *symbol;
+
+    uint32_t *fail;
+    // ближайшая по суффиксным ссылкам вершина, в которой кончается паттерн
+    uint32_t *outLink;
+    uint32_t *depth;
+    size_t *firstPattern;
+    size_t nodeCount;
+    size_t nodeCap;
+
+    // паттерны с одинаковой строкой кончаются в одной вершине
+    size_t *nextPattern;
+    size_t patternCount;
+    size_t patternCap;
+    size_t maxLength;
+} _Automaton, *Automaton;
+
+static inline size_t hashEdge(uint64_t key, size_t cap) {
+    return (key * 0x9E3779B97F4A7C15ULL) >> 32 & (cap - 1);
+}
+
+uint32_t getTransition(Automaton a, uint32_t node, uint32_t sym) {
+    uint64_t key = (uint64_t)node << 32 | sym;
+    size_t slot = hashEdge(key, a->tableCap);
+
+    while (a->keys[slot] != EMPTY_KEY) {
+        if (a->keys[slot] == key) return a->values[slot];
+        slot = (slot + 1) & (a->tableCap - 1);
+    }
+
+    return NO_NODE;
+}
+
+void insertEdge(uint64_t *keys, uint32_t *values, size_t cap, uint64_t key, uint32_t value) {
+    size_t slot = hashEdge(key, cap);
+
+    while (keys[slot] != EMPTY_KEY) {
+        slot = (slot + 1) & (cap - 1);
+    }
+
+    keys[slot] = key;
+    values[slot] = value;
+}
+
+void extendTable(Automaton a) {
+    size_t newCap = a->tableCap * 2;
+    uint64_t *newKeys = malloc(sizeof(uint64_t) * newCap);
+    uint32_t *newValues = malloc(sizeof(uint32_t) * newCap);
+
+    for (size_t i = 0; i < newCap; i++) newKeys[i] = EMPTY_KEY;
+
+    for (size_t i = 0; i < a->tableCap; i++) {
+        if (a->keys[i] != EMPTY_KEY) insertEdge(newKeys, newValues, newCap, a->keys[i], a->values[i]);
+    }
+
+    free(a->keys);
+    free(a->values);
+    a->keys = newKeys;
+    a->values = newValues;
+    a->tableCap = newCap;
+}
+
+uint32_t addNode(Automaton a, uint32_t parent, uint32_t sym) {
+    if (a->nodeCount >= a->nodeCap) {
+        a->nodeCap *= 2;
+        a->firstChild = realloc(a->firstChild, sizeof(uint32_t) * a->nodeCap);
+        a->nextSibling = realloc(a->nextSibling, sizeof(uint32_t) * a->nodeCap);
+        a->symbol = realloc(a->symbol, sizeof(uint32_t) * a->nodeCap);
+        a->fail = realloc(a->fail, sizeof(uint32_t) * a->nodeCap);
+        a->outLink = realloc(a->outLink, sizeof(uint32_t) * a->nodeCap);
+        a->depth = realloc(a->depth, sizeof(uint32_t) * a->nodeCap);
+        a->firstPattern = realloc(a->firstPattern, sizeof(size_t) * a->nodeCap);
+    }
+
+    uint32_t node = a->nodeCount++;
+
+    a->firstChild[node] = NO_NODE;
+    a->nextSibling[node] = NO_NODE;
+    a->symbol[node] = sym;
+    a->fail[node] = ROOT;
+    a->outLink[node] = NO_NODE;
+    a->depth[node] = 0;
+    a->firstPattern[node] = NO_PATTERN;
+
+    if (parent != NO_NODE) {
+        a->depth[node] = a->depth[parent] + 1;
+        a->nextSibling[node] = a->firstChild[parent];
+        a->firstChild[parent] = node;
+
+        if ((a->edgeCount + 1) * 2 > a->tableCap) extendTable(a);
+        insertEdge(a->keys, a->values, a->tableCap, (uint64_t)parent << 32 | sym, node);
+        a->edgeCount++;
+    }
+
+    return node;
+}
+
+Automaton createAutomaton() {
+    Automaton a = malloc(sizeof(_Automaton));
+
+    a->tableCap = 16;
+    a->edgeCount = 0;
+    a->keys = malloc(sizeof(uint64_t) * a->tableCap);
+    a->values = malloc(sizeof(uint32_t) * a->tableCap);
+    for (size_t i = 0; i < a->tableCap; i++) a->keys[i] = EMPTY_KEY;
+
+    a->nodeCap = 16;
+    a->nodeCount = 0;
+    a->firstChild = malloc(sizeof(uint32_t) * a->nodeCap);
+    a->nextSibling = malloc(sizeof(uint32_t) * a->nodeCap);
+    a->symbol = malloc(sizeof(uint32_t) * a->nodeCap);
+    a->fail = malloc(sizeof(uint32_t) * a->nodeCap);
+    a->outLink = malloc(sizeof(uint32_t) * a->nodeCap);
+    a->depth = malloc(sizeof(uint32_t) * a->nodeCap);
+    a->firstPattern = malloc(sizeof(size_t) * a->nodeCap);
+
+    a->patternCap = 16;
+    a->patternCount = 0;
+    a->nextPattern = malloc(sizeof(size_t) * a->patternCap);
+    a->maxLength = 0;
+
+    addNode(a, NO_NODE, 0);
+
+    return a;
+}
+
+void deleteAutomaton(Automaton a) {
+    free(a->keys);
+    free(a->values);
+    free(a->firstChild);
+    free(a->nextSibling);
+    free(a->symbol);
+    free(a->fail);
+    free(a->outLink);
+    free(a->depth);
+    free(a->firstPattern);
+    free(a->nextPattern);
+    free(a);
+}
+
+// пустой паттерн получает номер, но никогда не находится
+void addPattern(Automaton a, uint32_t *P, size_t m) {
+    if (a->patternCount >= a->patternCap) {
+        a->patternCap *= 2;
+        a->nextPattern = realloc(a->nextPattern, sizeof(size_t) * a->patternCap);
+    }
+
+    size_t id = a->patternCount++;
+    a->nextPattern[id] = NO_PATTERN;
+    if (m == 0) return;
+
+    uint32_t node = ROOT;
+    for (size_t i = 0; i < m; i++) {
+        uint32_t next = getTransition(a, node, P[i]);
+        if (next == NO_NODE) next = addNode(a, node, P[i]);
+        node = next;
+    }
+
+    // держим список в порядке добавления
+    if (a->firstPattern[node] == NO_PATTERN) {
+        a->firstPattern[node] = id;
+    } else {
+        size_t last = a->firstPattern[node];
+        while (a->nextPattern[last] != NO_PATTERN) last = a->nextPattern[last];
+        a->nextPattern[last] = id;
+    }
+
+    if (m > a->maxLength) a->maxLength = m;
+}
+
+// суффиксные и выходные ссылки обходом в ширину
+void buildLinks(Automaton a) {
+    uint32_t *queue = malloc(sizeof(uint32_t) * a->nodeCount);
+    size_t head = 0;
+    size_t tail = 0;
+
+    queue[tail++] = ROOT;
+
+    while (head < tail) {
+        uint32_t node = queue[head++];
+
+        for (uint32_t child = a->firstChild[node]; child != NO_NODE; child = a->nextSibling[child]) {
+            uint32_t sym = a->symbol[child];
+            uint32_t f = a->fail[node];
+            uint32_t target = NO_NODE;
+
+            if (node != ROOT) {
+                while ((target = getTransition(a, f, sym)) == NO_NODE && f != ROOT) f = a->fail[f];
+            }
+
+            a->fail[child] = target == NO_NODE ? ROOT : target;
+
+            uint32_t link = a->fail[child];
+            a->outLink[child] = a->firstPattern[link] != NO_PATTERN ? link : a->outLink[link];
+
+            queue[tail++] = child;
+        }
+    }
+
+    free(queue);
+}
+
+// паттерны по одному в строке
+Automaton readPatterns(FILE *file) {
+    Automaton a = createAutomaton();
+    TextReader reader = createTextReader(file);
+
+    while (fillBlock(reader)) {
+        size_t m;
+        uint32_t *P = readSequence(reader, &m);
+        addPattern(a, P, m);
+        free(P);
     }
 
     deleteTextReader(reader);
+    buildLinks(a);
+
+    return a;
 }
 
-int main() {
-    size_t patternSize;
-    uint32_t *pattern = readSequence(&patternSize);
+// печатает "номер паттерна: строка, позиция" для каждого вхождения в порядке их окончания
+void searchMany(Automaton a, TextReader reader) {
+    if (a->maxLength == 0) return;
+
+    Tokens batch = createTokens(BATCH_SIZE);
+    History history = createHistory(a->maxLength - 1);
+
+    uint32_t node = ROOT;
+    size_t offset = 0;
+
+    while (readTokens(reader, &batch, BATCH_SIZE, false) > 0) {
+        for (size_t i = 0; i < batch.size; i++) {
+            uint32_t num = batch.nums[i];
+            uint32_t next;
+
+            while ((next = getTransition(a, node, num)) == NO_NODE && node != ROOT) node = a->fail[node];
+            node = next == NO_NODE ? ROOT : next;
+
+            uint32_t out = a->firstPattern[node] != NO_PATTERN ? node : a->outLink[node];
 
-    uint16_t *SP = preprocess(pattern, patternSize);
+            for (; out != NO_NODE; out = a->outLink[out]) {
+                int64_t line;
+                size_t lineIndex;
+                positionOf(&batch, &history, offset, offset + i + 1 - a->depth[out], &line, &lineIndex);
+
+                for (size_t id = a->firstPattern[out]; id != NO_PATTERN; id = a->nextPattern[id]) {
+                    printf("%zu: %ld, %lu\n", id + 1, line + 1, lineIndex + 1);
+                }
+            }
+        }
+
+        rememberTail(&history, &batch, offset);
+        offset += batch.size;
+    }
+
+    deleteHistory(&history);
+    deleteTokens(&batch);
+}
 
-    search(pattern, patternSize, SP);
+// ./app.out              - паттерн в первой строке stdin, дальше текст
+// ./app.out -p file.txt  - паттерны по одному в строке из файла, текст из stdin
+// ./app.out -j N         - то же, что без ключей, но в N потоков (stdin должен быть файлом)
+// ./app.out -k K         - то же, что без ключей, но вхождения с не более чем K несовпадениями
+// ./app.out -c out.bin   - перевести текст из stdin (без строки паттерна) в бинарный вид
+// ./app.out -b text.bin  - паттерн в первой строке stdin, текст из бинарного файла
+int main(int argc, char **argv) {
+    if (argc >= 3 && strcmp(argv[1], "-j") == 0) {
+        int threads = atoi(argv[2]);
+        struct stat st;
 
-    free(SP);
+        if (threads > 1 && fstat(0, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            char *text = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, 0, 0);
+
+            if (text != MAP_FAILED) {
+                madvise(text, st.st_size, MADV_SEQUENTIAL);
+                parallelSearch(text, st.st_size, threads);
+                munmap(text, st.st_size);
+                return 0;
+            }
+        }
+    }
+
+    long k = 0;
+    if (argc >= 3 && strcmp(argv[1], "-k") == 0) {
+        char *end;
+        k = strtol(argv[2], &end, 10);
+
+        if (end == argv[2] || *end != '\0' || k < 0) {
+            fprintf(stderr, "usage: %s -k K, K >= 0\n", argv[0]);
+            return 1;
+        }
+    }
+
+    TextReader reader = createTextReader(stdin);
+
+    if (argc >= 3 && strcmp(argv[1], "-c") == 0) {
+        FILE *out = fopen(argv[2], "wb");
+        bool ok = out != NULL && convertText(reader, out);
+        ok = out != NULL && fclose(out) == 0 && ok;
+        if (!ok) perror(argv[2]);
+
+        deleteTextReader(reader);
+        return ok ? 0 : 1;
+    }
+
+    if (argc >= 3 && strcmp(argv[1], "-b") == 0) {
+        Corpus corpus = openCorpus(argv[2]);
+        if (corpus == NULL) {
+            fprintf(stderr, "%s: not a binary text file\n", argv[2]);
+            deleteTextReader(reader);
+            return 1;
+        }
+
+        size_t patternSize;
+        uint32_t *pattern = readSequence(reader, &patternSize);
+
+        searchCorpus(pattern, patternSize, corpus, printMatch, NULL);
+
+        closeCorpus(corpus);
+        deleteTextReader(reader);
+        free(pattern);
+        return 0;
+    }
+
+    if (argc >= 3 && strcmp(argv[1], "-p") == 0) {
+        FILE *file = fopen(argv[2], "r");
+        if (file == NULL) {
+            perror(argv[2]);
+            deleteTextReader(reader);
+            return 1;
+        }
+
+        Automaton automaton = readPatterns(file);
+        fclose(file);
+
+        searchMany(automaton, reader);
+
+        deleteAutomaton(automaton);
+        deleteTextReader(reader);
+        return 0;
+    }
+
+    size_t patternSize;
+    uint32_t *pattern = readSequence(reader, &patternSize);
+
+    if (argc >= 3 && strcmp(argv[1], "-k") == 0) {
+        searchApprox(pattern, patternSize, k, reader, printMatch, NULL);
+    } else {
+        search(pattern, patternSize, reader);
+    }
+
+    deleteTextReader(reader);
     free(pattern);
     return 0;
 }
@@ -0,0 +1,172 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <time.h>
+#include <malloc.h>
+
+// поиск документов с паттерном: один обобщенный суффиксный массив по всем документам
+// против отдельного суффиксного дерева на каждый документ.
+// lab5/main.c подключается объектником, собранным с -Dmain=lab5Main
+
+#define DEFAULT_SIZE 200000
+#define DEFAULT_DOC_LENGTH 50
+#define QUERIES 64
+
+// lab5
+typedef struct SuffixTree *SuffixTree;
+SuffixTree buildSuffixTree(char *text, long m);
+void deleteSuffixTree(SuffixTree tree);
+long countMatches(SuffixTree tree, char *pattern, long m);
+typedef struct DocumentIndex *DocumentIndex;
+DocumentIndex buildDocumentIndex(char *text, long n, uint32_t docCount);
+void deleteDocumentIndex(DocumentIndex index);
+long listDocuments(DocumentIndex index, char *pattern, long m, uint32_t **docs, long *docCap);
+
+// документы склеены в text, каждый заканчивается '\n'
+typedef struct Collection {
+    char *text;
+    long n;
+    long *starts;
+    uint32_t docCount;
+} Collection;
+
+uint64_t rngState = 88172645463325252ULL;
+
+uint64_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return rngState;
+}
+
+// длины документов равномерно от 1 до 2 * docLength, буквы a..h
+Collection generateCollection(long n, long docLength) {
+    Collection res;
+    res.text = malloc(n + 2 * docLength + 1);
+    res.starts = malloc(sizeof(long) * (n + 1));
+    res.docCount = 0;
+
+    long pos = 0;
+    while (pos < n) {
+        long length = 1 + nextRandom() % (2 * docLength);
+        res.starts[res.docCount++] = pos;
+
+        for (long i = 0; i < length; i++) res.text[pos++] = 'a' + nextRandom() % 8;
+        res.text[pos++] = '\n';
+    }
+
+    res.starts[res.docCount] = pos;
+    res.n = pos;
+    return res;
+}
+
+double nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+size_t heapInUse() {
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+void printRow(const char *name, size_t m, double build, double search, size_t memory, long found, bool ok) {
+    printf("%-20s %4zu %10.2f %10.2f %10.1f %10ld%s\n", name, m, build / 1e6, search / 1e6,
+        memory / 1048576.0, found, ok ? "" : "   FAILED");
+    fflush(stdout);
+}
+
+// ./docBench.out [n] [docLength]
+int main(int argc, char **argv) {
+    long n = DEFAULT_SIZE;
+    long docLength = DEFAULT_DOC_LENGTH;
+    if (argc > 1) n = strtol(argv[1], NULL, 10);
+    if (argc > 2) docLength = strtol(argv[2], NULL, 10);
+    if (n <= 0 || docLength <= 0) return 1;
+
+    Collection collection = generateCollection(n, docLength);
+    size_t lengths[] = {2, 4, 8};
+
+    printf("n = %ld, %u documents, %d queries\n", collection.n, collection.docCount, QUERIES);
+    printf("%-20s %4s %10s %10s %10s %10s\n", "index", "m", "build, ms", "search, ms", "memory, MB", "documents");
+
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(size_t); l++) {
+        size_t m = lengths[l];
+        char patterns[QUERIES][16];
+
+        // паттерны - куски случайных документов, достаточно длинных для них
+        for (int q = 0; q < QUERIES; q++) {
+            uint32_t d;
+            do {
+                d = nextRandom() % collection.docCount;
+            } while (collection.starts[d + 1] - collection.starts[d] - 1 < (long)m);
+
+            long room = collection.starts[d + 1] - collection.starts[d] - m;
+            memcpy(patterns[q], collection.text + collection.starts[d] + nextRandom() % room, m);
+            patterns[q][m] = '\0';
+        }
+
+        // обобщенный массив
+        size_t heapBefore = heapInUse();
+        double start = nowNs();
+        DocumentIndex index = buildDocumentIndex(collection.text, collection.n, collection.docCount);
+        double build = nowNs() - start;
+        size_t memory = heapInUse() - heapBefore;
+
+        uint32_t *docs = NULL;
+        long docCap = 0;
+        long expected[QUERIES];
+        long found = 0;
+
+        start = nowNs();
+        for (int q = 0; q < QUERIES; q++) {
+            expected[q] = listDocuments(index, patterns[q], m, &docs, &docCap);
+            found += expected[q];
+        }
+        double search = nowNs() - start;
+
+        printRow("generalized array", m, build, search, memory, found, true);
+
+        free(docs);
+        deleteDocumentIndex(index);
+
+        // по дереву на документ; тексты деревьев - куски той же склейки
+        heapBefore = heapInUse();
+        start = nowNs();
+        SuffixTree *trees = malloc(sizeof(SuffixTree) * collection.docCount);
+        for (uint32_t d = 0; d < collection.docCount; d++) {
+            long from = collection.starts[d];
+            trees[d] = buildSuffixTree(collection.text + from, collection.starts[d + 1] - from);
+        }
+        build = nowNs() - start;
+        memory = heapInUse() - heapBefore;
+
+        bool ok = true;
+        found = 0;
+
+        start = nowNs();
+        for (int q = 0; q < QUERIES; q++) {
+            long count = 0;
+            for (uint32_t d = 0; d < collection.docCount; d++) {
+                if (countMatches(trees[d], patterns[q], m) > 0) count++;
+            }
+
+            ok = ok && count == expected[q];
+            found += count;
+        }
+        search = nowNs() - start;
+
+        printRow("tree per document", m, build, search, memory, found, ok);
+
+        for (uint32_t d = 0; d < collection.docCount; d++) deleteSuffixTree(trees[d]);
+        free(trees);
+    }
+
+    free(collection.text);
+    free(collection.starts);
+    return 0;
+}
@@ -0,0 +1,13 @@
+#include <cstddef>
+#include <string_view>
+
+// число вхождений (с перекрытиями) через std::string_view::find, тот же алгоритм, что у std::string::find
+extern "C" size_t stringFindCount(const char *text, size_t n, const char *pattern, size_t m) {
+    std::string_view t(text, n);
+    std::string_view p(pattern, m);
+
+    size_t count = 0;
+    for (size_t pos = t.find(p); pos != std::string_view::npos; pos = t.find(p, pos + 1)) count++;
+
+    return count;
+}
@@ -0,0 +1,412 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <time.h>
+#include <malloc.h>
+
+// общий стенд для поиска подстрок: lab4 (KMP по токенам) и lab5 (суффиксное дерево и массив)
+// против наивного поиска, memmem и std::string::find.
+// lab4/main.c и lab5/main.c подключаются объектниками, собранными с -Dmain=<имя>Main
+
+#define DEFAULT_SIZE 1000000
+#define QUERIES 16
+#define DNA_COPY_CHANCE 20
+#define DNA_MUTATION 100
+
+// lab4
+typedef struct Matcher *Matcher;
+Matcher createMatcher(const uint32_t *P, size_t m, void (*onMatch)(void *ctx, size_t start), void *ctx);
+void feedMatcher(Matcher matcher, const uint32_t *tokens, size_t count);
+void resetMatcher(Matcher matcher);
+void deleteMatcher(Matcher matcher);
+
+// lab5
+typedef struct SuffixTree *SuffixTree;
+SuffixTree buildSuffixTree(char *text, long m);
+void deleteSuffixTree(SuffixTree tree);
+long collectMatches(SuffixTree tree, char *pattern, long m, uint32_t **matches, long *matchCap);
+typedef struct SuffixArray *SuffixArray;
+SuffixArray buildSuffixArray(char *text, long n);
+void deleteSuffixArray(SuffixArray sa);
+long collectMatchesSA(SuffixArray sa, char *pattern, long m, uint32_t **matches, long *matchCap);
+
+size_t stringFindCount(const char *text, size_t n, const char *pattern, size_t m);
+
+// текст и паттерны в двух видах: символы для lab5 и библиотечных функций, токены для lab4
+typedef struct Input {
+    char *text;
+    uint32_t *tokens;
+    size_t n;
+} Input;
+
+typedef struct Query {
+    char *pattern;
+    uint32_t *tokens;
+    size_t m;
+} Query;
+
+// ================ движки ================
+
+typedef struct Engine {
+    const char *name;
+    // индекс по тексту, NULL - не нужен
+    void* (*indexText)(Input *input);
+    void (*freeText)(void *index);
+    // подготовка паттерна, NULL - не нужна
+    void* (*preparePattern)(Query *query);
+    void (*freePattern)(void *prepared);
+    size_t (*count)(Input *input, void *index, Query *query, void *prepared);
+} Engine;
+
+size_t naiveCount(Input *input, void *index, Query *query, void *prepared) {
+    (void)index;
+    (void)prepared;
+
+    const char *t = input->text;
+    const char *p = query->pattern;
+    size_t m = query->m;
+    size_t count = 0;
+
+    for (size_t i = 0; i + m <= input->n; i++) {
+        size_t j = 0;
+        while (j < m && t[i + j] == p[j]) j++;
+        if (j == m) count++;
+    }
+
+    return count;
+}
+
+size_t memmemCount(Input *input, void *index, Query *query, void *prepared) {
+    (void)index;
+    (void)prepared;
+
+    const char *end = input->text + input->n;
+    size_t count = 0;
+
+    for (const char *pos = input->text; pos < end; pos++) {
+        pos = memmem(pos, end - pos, query->pattern, query->m);
+        if (pos == NULL) break;
+        count++;
+    }
+
+    return count;
+}
+
+size_t findCount(Input *input, void *index, Query *query, void *prepared) {
+    (void)index;
+    (void)prepared;
+    return stringFindCount(input->text, input->n, query->pattern, query->m);
+}
+
+typedef struct TokenMatcher {
+    Matcher matcher;
+    size_t count;
+} TokenMatcher;
+
+void countTokenMatch(void *ctx, size_t start) {
+    (void)start;
+    ((TokenMatcher*)ctx)->count++;
+}
+
+void* lab4Prepare(Query *query) {
+    TokenMatcher *res = malloc(sizeof(TokenMatcher));
+    res->matcher = createMatcher(query->tokens, query->m, countTokenMatch, res);
+    res->count = 0;
+    return res;
+}
+
+void lab4Free(void *prepared) {
+    deleteMatcher(((TokenMatcher*)prepared)->matcher);
+    free(prepared);
+}
+
+size_t lab4Count(Input *input, void *index, Query *query, void *prepared) {
+    (void)index;
+    (void)query;
+
+    TokenMatcher *matcher = prepared;
+    matcher->count = 0;
+    resetMatcher(matcher->matcher);
+    feedMatcher(matcher->matcher, input->tokens, input->n);
+
+    return matcher->count;
+}
+
+typedef struct TreeIndex {
+    SuffixTree tree;
+    uint32_t *matches;
+    long matchCap;
+} TreeIndex;
+
+void* lab5Index(Input *input) {
+    TreeIndex *res = malloc(sizeof(TreeIndex));
+    // за текстом стоит '\n' - терминатор, как после readText
+    res->tree = buildSuffixTree(input->text, input->n + 1);
+    res->matches = NULL;
+    res->matchCap = 0;
+    return res;
+}
+
+void lab5Free(void *index) {
+    TreeIndex *tree = index;
+    deleteSuffixTree(tree->tree);
+    free(tree->matches);
+    free(tree);
+}
+
+size_t lab5Count(Input *input, void *index, Query *query, void *prepared) {
+    (void)input;
+    (void)prepared;
+
+    TreeIndex *tree = index;
+    return collectMatches(tree->tree, query->pattern, query->m, &tree->matches, &tree->matchCap);
+}
+
+typedef struct ArrayIndex {
+    SuffixArray sa;
+    uint32_t *matches;
+    long matchCap;
+} ArrayIndex;
+
+void* lab5ArrayIndex(Input *input) {
+    ArrayIndex *res = malloc(sizeof(ArrayIndex));
+    res->sa = buildSuffixArray(input->text, input->n + 1);
+    res->matches = NULL;
+    res->matchCap = 0;
+    return res;
+}
+
+void lab5ArrayFree(void *index) {
+    ArrayIndex *array = index;
+    deleteSuffixArray(array->sa);
+    free(array->matches);
+    free(array);
+}
+
+size_t lab5ArrayCount(Input *input, void *index, Query *query, void *prepared) {
+    (void)input;
+    (void)prepared;
+
+    ArrayIndex *array = index;
+    return collectMatchesSA(array->sa, query->pattern, query->m, &array->matches, &array->matchCap);
+}
+
+Engine engines[] = {
+    {"naive", NULL, NULL, NULL, NULL, naiveCount},
+    {"memmem", NULL, NULL, NULL, NULL, memmemCount},
+    {"std::string::find", NULL, NULL, NULL, NULL, findCount},
+    {"lab4/kmp", NULL, NULL, lab4Prepare, lab4Free, lab4Count},
+    {"lab5/suffixTree", lab5Index, lab5Free, NULL, NULL, lab5Count},
+    {"lab5/suffixArray", lab5ArrayIndex, lab5ArrayFree, NULL, NULL, lab5ArrayCount},
+};
+
+// ================ генерация входа ================
+
+typedef enum TextKind {
+    RANDOM,
+    PERIODIC,
+    FIBONACCI,
+    DNA,
+    WORST_NAIVE,
+    TEXT_KIND_COUNT
+} TextKind;
+
+const char *textKindNames[] = {"random", "periodic", "fibonacci", "dna", "worst-naive"};
+
+uint64_t rngState = 88172645463325252ULL;
+
+uint64_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return rngState;
+}
+
+void generateText(char *text, size_t n, TextKind kind) {
+    const char *dna = "acgt";
+    char period[7];
+
+    switch (kind) {
+        case RANDOM:
+            for (size_t i = 0; i < n; i++) text[i] = 'a' + nextRandom() % 26;
+            break;
+        case PERIODIC:
+            for (int i = 0; i < 7; i++) period[i] = 'a' + nextRandom() % 26;
+            for (size_t i = 0; i < n; i++) text[i] = period[i % 7];
+            break;
+        case FIBONACCI: {
+            // слово Фибоначчи: s(k) = s(k - 1) s(k - 2), и s(k - 2) - префикс текста.
+            // Начинаем с s(2) = "ab", |s(1)| = 1
+            text[0] = 'a';
+            if (n > 1) text[1] = 'b';
+
+            size_t len = 2;
+            size_t prevLen = 1;
+            while (len < n) {
+                size_t add = prevLen < n - len ? prevLen : n - len;
+                memcpy(text + len, text, add);
+                prevLen = len;
+                len += add;
+            }
+            break;
+        }
+        case DNA:
+            // случайные нуклеотиды, иногда копия более раннего куска с мутациями (повторы)
+            for (size_t i = 0; i < n;) {
+                if (i > 1000 && nextRandom() % DNA_COPY_CHANCE == 0) {
+                    size_t len = 100 + nextRandom() % 900;
+                    size_t from = nextRandom() % (i - len);
+                    for (size_t j = 0; j < len && i < n; j++, i++) {
+                        text[i] = nextRandom() % DNA_MUTATION == 0 ? dna[nextRandom() % 4] : text[from + j];
+                    }
+                } else {
+                    text[i++] = dna[nextRandom() % 4];
+                }
+            }
+            break;
+        case WORST_NAIVE:
+            memset(text, 'a', n);
+            break;
+        default:
+            break;
+    }
+}
+
+// паттерны - куски текста (значит, вхождения есть); для worst-naive - a...ab
+void generateQuery(Query *query, Input *input, size_t m, TextKind kind) {
+    query->m = m;
+    query->pattern = malloc(m + 1);
+    query->tokens = malloc(sizeof(uint32_t) * m);
+
+    if (kind == WORST_NAIVE) {
+        memset(query->pattern, 'a', m - 1);
+        query->pattern[m - 1] = 'b';
+    } else {
+        memcpy(query->pattern, input->text + nextRandom() % (input->n - m + 1), m);
+    }
+    query->pattern[m] = '\0';
+
+    for (size_t i = 0; i < m; i++) query->tokens[i] = (unsigned char)query->pattern[i];
+}
+
+// ================ прогон ================
+
+double nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+size_t heapInUse() {
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+// эталонный движок записывает ответы в expected, остальные с ними сверяются
+void benchmark(Engine *engine, Input *input, Query *queries, size_t *expected, bool reference, TextKind kind, size_t m, int reps) {
+    double bestPrep = -1;
+    double bestSearch = -1;
+    size_t memory = 0;
+    bool ok = true;
+
+    for (int r = 0; r < reps; r++) {
+        void *prepared[QUERIES] = {NULL};
+        void *index = NULL;
+
+        size_t heapBefore = heapInUse();
+        double start = nowNs();
+
+        if (engine->indexText != NULL) index = engine->indexText(input);
+        if (engine->preparePattern != NULL) {
+            for (int q = 0; q < QUERIES; q++) prepared[q] = engine->preparePattern(&queries[q]);
+        }
+
+        double prep = nowNs() - start;
+        size_t heapAfter = heapInUse();
+
+        start = nowNs();
+        for (int q = 0; q < QUERIES; q++) {
+            size_t count = engine->count(input, index, &queries[q], prepared[q]);
+            if (reference) expected[q] = count;
+            else ok = ok && count == expected[q];
+        }
+        double search = nowNs() - start;
+
+        if (engine->freePattern != NULL) {
+            for (int q = 0; q < QUERIES; q++) engine->freePattern(prepared[q]);
+        }
+        if (engine->freeText != NULL) engine->freeText(index);
+
+        if (bestPrep < 0 || prep < bestPrep) bestPrep = prep;
+        if (bestSearch < 0 || search < bestSearch) bestSearch = search;
+        memory = heapAfter > heapBefore ? heapAfter - heapBefore : 0;
+    }
+
+    // ns/char - время поиска одного паттерна, деленное на длину текста
+    printf("%-18s %-11s %6zu %10.2f %10.2f %10.3f %10.1f%s\n", engine->name, textKindNames[kind], m,
+        bestPrep / 1e6, bestSearch / 1e6, bestSearch / QUERIES / input->n,
+        memory / 1048576.0, ok ? "" : "   FAILED");
+    fflush(stdout);
+}
+
+typedef struct Options {
+    size_t n;
+    int reps;
+} Options;
+
+void run(Options *options) {
+    size_t n = options->n;
+    size_t lengths[] = {8, 64, 512};
+
+    Input input;
+    input.n = n;
+    input.text = malloc(n + 1);
+    input.tokens = malloc(sizeof(uint32_t) * n);
+
+    printf("n = %zu, %d queries, best of %d\n", n, QUERIES, options->reps);
+    printf("%-18s %-11s %6s %10s %10s %10s %10s\n", "engine", "text", "m", "prep, ms", "search, ms", "ns/char", "memory, MB");
+
+    int engineCount = sizeof(engines) / sizeof(Engine);
+
+    for (int kind = 0; kind < TEXT_KIND_COUNT; kind++) {
+        generateText(input.text, n, kind);
+        input.text[n] = '\n';
+        for (size_t i = 0; i < n; i++) input.tokens[i] = (unsigned char)input.text[i];
+
+        for (size_t l = 0; l < sizeof(lengths) / sizeof(size_t); l++) {
+            size_t m = lengths[l];
+            if (m > n) continue;
+
+            Query queries[QUERIES];
+            size_t expected[QUERIES];
+            for (int q = 0; q < QUERIES; q++) generateQuery(&queries[q], &input, m, kind);
+
+            // первый движок - наивный, он задает ответы
+            for (int e = 0; e < engineCount; e++) {
+                benchmark(&engines[e], &input, queries, expected, e == 0, kind, m, options->reps);
+            }
+
+            for (int q = 0; q < QUERIES; q++) {
+                free(queries[q].pattern);
+                free(queries[q].tokens);
+            }
+        }
+    }
+
+    free(input.text);
+    free(input.tokens);
+}
+
+// ./matchBench.out [n] [reps]
+int main(int argc, char **argv) {
+    Options options = {DEFAULT_SIZE, 3};
+    if (argc > 1) options.n = strtoull(argv[1], NULL, 10);
+    if (argc > 2) options.reps = atoi(argv[2]);
+    if (options.n == 0 || options.reps <= 0) return 1;
+
+    run(&options);
+    return 0;
+}
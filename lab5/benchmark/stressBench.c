@@ -0,0 +1,176 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <time.h>
+#include <malloc.h>
+#include <sys/resource.h>
+
+// суффиксное дерево lab5 на вырожденных текстах: на "aaaa..." и периодических строках
+// глубина дерева - O(n), все обходы должны проходить без рекурсии.
+// Стек по умолчанию не увеличиваем - упавший прогон и есть провал.
+// lab5/main.c подключается объектником, собранным с -Dmain=lab5Main
+
+#define DEFAULT_SIZE 2000000
+#define QUERY_LENGTH 8
+#define PERIOD "abcab"
+
+// lab5
+typedef uint32_t Pos;
+typedef struct SuffixTree *SuffixTree;
+SuffixTree buildSuffixTree(char *text, long m);
+void deleteSuffixTree(SuffixTree tree);
+long collectMatches(SuffixTree tree, char *pattern, long m, uint32_t **matches, long *matchCap);
+
+// как в lab5/main.c
+typedef struct RepeatInfo {
+    long depth;
+    uint32_t firstA;
+    uint32_t firstB;
+    long count;
+    int left;
+} RepeatInfo;
+
+typedef struct Repeats {
+    RepeatInfo longest;
+    RepeatInfo *maximal;
+    long maximalCount;
+    long maximalCap;
+} Repeats;
+
+Repeats findRepeatsS3(SuffixTree tree, Pos split, long minLength);
+
+typedef enum TextKind {
+    SAME,
+    PERIODIC,
+    FIBONACCI,
+    RANDOM,
+    TEXT_KIND_COUNT
+} TextKind;
+
+const char *textNames[] = {"aaaa", "periodic", "fibonacci", "random"};
+
+uint64_t rngState = 88172645463325252ULL;
+
+uint64_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return rngState;
+}
+
+// n байт текста и '\n' за ними
+void generateText(char *text, long n, TextKind kind) {
+    long period = strlen(PERIOD);
+
+    switch (kind) {
+        case SAME:
+            memset(text, 'a', n);
+            break;
+        case PERIODIC:
+            for (long i = 0; i < n; i++) text[i] = PERIOD[i % period];
+            break;
+        case FIBONACCI:
+            // слово Фибоначчи: s1 = "a", s2 = "ab", s_k = s_{k-1} s_{k-2};
+            // каждое следующее начинается с предыдущего, поэтому достраиваем на месте
+            text[0] = 'a';
+            if (n > 1) text[1] = 'b';
+            for (long prev = 1, len = n > 1 ? 2 : 1; len < n;) {
+                long add = prev < n - len ? prev : n - len;
+                memcpy(text + len, text, add);
+                prev = len;
+                len += add;
+            }
+            break;
+        case RANDOM:
+            for (long i = 0; i < n; i++) text[i] = 'a' + nextRandom() % 4;
+            break;
+        default:
+            break;
+    }
+
+    text[n] = '\n';
+}
+
+double nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+size_t heapInUse() {
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+long peakRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+long naiveCount(const char *text, long n, const char *pattern, long m) {
+    long count = 0;
+    for (long i = 0; i + m <= n; i++) {
+        if (memcmp(text + i, pattern, m) == 0) count++;
+    }
+    return count;
+}
+
+// ./stressBench.out [n]
+int main(int argc, char **argv) {
+    long n = DEFAULT_SIZE;
+    if (argc > 1) n = strtol(argv[1], NULL, 10);
+    if (n <= QUERY_LENGTH || n >= UINT32_MAX) return 1;
+
+    char *text = malloc(n + 1);
+
+    printf("n = %ld\n", n);
+    printf("%-10s %10s %10s %10s %10s %10s %10s %12s\n", "text", "build, ms", "walk, ms", "search, ms",
+        "free, ms", "memory, MB", "peak, MB", "longest");
+
+    for (int kind = 0; kind < TEXT_KIND_COUNT; kind++) {
+        generateText(text, n, kind);
+
+        size_t heapBefore = heapInUse();
+        double start = nowNs();
+        SuffixTree tree = buildSuffixTree(text, n + 1);
+        double build = nowNs() - start;
+        size_t memory = heapInUse() - heapBefore;
+
+        // полный обход снизу вверх на всю глубину дерева
+        start = nowNs();
+        Repeats repeats = findRepeatsS3(tree, n + 1, n + 1);
+        double walk = nowNs() - start;
+
+        // паттерн из середины текста: на вырожденных текстах у него O(n) вхождений
+        char *pattern = text + n / 2 - QUERY_LENGTH;
+        uint32_t *matches = NULL;
+        long matchCap = 0;
+
+        start = nowNs();
+        long found = collectMatches(tree, pattern, QUERY_LENGTH, &matches, &matchCap);
+        double search = nowNs() - start;
+
+        bool ok = found == naiveCount(text, n, pattern, QUERY_LENGTH);
+        if (kind == SAME) ok = ok && repeats.longest.depth == n - 1;
+        if (kind == PERIODIC) ok = ok && repeats.longest.depth == n - (long)strlen(PERIOD);
+
+        start = nowNs();
+        deleteSuffixTree(tree);
+        double teardown = nowNs() - start;
+
+        printf("%-10s %10.2f %10.2f %10.2f %10.2f %10.1f %10.1f %12ld%s\n", textNames[kind], build / 1e6,
+            walk / 1e6, search / 1e6, teardown / 1e6, memory / 1048576.0, peakRssKb() / 1024.0,
+            repeats.longest.depth, ok ? "" : "   FAILED");
+        fflush(stdout);
+
+        free(matches);
+        free(repeats.maximal);
+    }
+
+    free(text);
+    return 0;
+}
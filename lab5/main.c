@@ -2,74 +2,328 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <inttypes.h>
+#include <limits.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
 
 #define EXTEND_SIZE 10
 #define NOT_LEAF UINT32_MAX
+#define NO_NODE UINT32_MAX
+#define NO_TABLE UINT32_MAX
+#define ROOT 0
 #define PRINT_LINE() printf("LINE: %d\n", __LINE__)
 #define PRINT_LOG(str) printf("%s, LINE: %d\n", str, __LINE__)
 
-struct S3_Node;
-
-typedef struct Pair {
-    char key;
-    struct S3_Node *value;
-} Pair;
-
-typedef struct Map {
-    unsigned char size;
-    unsigned char cap;
-    Pair *items;
-} Map;
-
-void initMap(Map *map);
-void setMap(Map *map, char key, struct S3_Node *value);
-struct S3_Node* getMap(Map *map, char key);
-void extendMap(Map *map);
-void deleteMap(Map *map, void (*destructor)(struct S3_Node*));
-
-typedef char* Pos;
-
+// вершины живут в одном массиве и ссылаются друг на друга по номерам,
+// поэтому массив можно расширять realloc'ом, а дерево удаляется целиком
+#define POOL_START_CAP 1024
+// больше стольких детей - заводим вершине прямую таблицу на весь алфавит
+#define DENSE_FANOUT 8
+// в тексте не больше стольких разных байт - таблица у каждой внутренней вершины
+// (вместе с заглушкой 8 ячеек - столько же памяти, сколько сама вершина)
+#define DIRECT_SIGMA 7
+#define ALPHABET 256
+// короче стольких вхождений сортируем вставками
+#define INSERTION_SORT_MAX 32
+// сортировка подсчетом, пока диапазон номеров не шире стольких вхождений
+#define COUNTING_RANGE_FACTOR 4
+#define RADIX_BITS 8
+// если нужна заметная доля вхождений, дешевле отсортировать все
+#define FIRST_FULL_SORT_RATIO 4
+
+// смещение в тексте
+typedef uint32_t Pos;
+
+// Дети вершины - односвязный список, упорядоченный по первой букве ребра.
+// Листья детей не имеют и памяти под них не тратят. Для вершин с большим
+// числом детей дополнительно заводится таблица номеров по сжатому алфавиту:
+// байты текста перенумерованы подряд (rank), ширина таблицы - степень двойки
+// не меньше их числа. Байтам, которых в тексте нет, достается общий
+// номер-заглушка, его ячейка всегда пустая - поиск по таблице обходится без
+// ветвлений. На маленьком алфавите (ДНК) таблица есть у каждой внутренней вершины.
 typedef struct S3_Node {
-    uint32_t leafNum;
     Pos start;
+    // конец ребра внутренней вершины; у листьев конец общий - tree->end
+    Pos end;
+    uint32_t leafNum;
+    uint32_t suffixLink;
 
-    // используем letter для внутренних вершин и ptr для листьев (глобальный указатель на конец)
-    union {
-        Pos letter;
-        Pos *ptr;
-    } end;
-
-    Map children;
-    struct S3_Node *suffixLink;
-} S3_Node, *S3;
-
-S3 createS3Node(Pos start, Pos end, uint32_t leafNum);
-char getCharS3(S3 node, long index);
-long lengthS3(S3 node);
-S3 splitS3(S3 node, int index);
-void deleteS3(S3 node);
-void printS3(S3 node, long offset);
+    uint32_t firstChild;
+    uint32_t nextSibling;
+    uint32_t table;
+    char key;
+} S3_Node;
 
-char* readText(long *length);
-char* readPattern(char *buffer, long *length, long *capacity);
+// активная точка алгоритма Укконена: вершина, первая буква ребра, пройдено по ребру
+typedef struct S3_Point {
+    uint32_t node;
+    Pos edge;
+    long length;
+} S3_Point;
 
 typedef struct SuffixTree {
+    char *text;
     Pos end;
-    S3 root;
+    // 0 - текст чужой; иначе дерево им владеет и расширяет при дописывании
+    long textCap;
+
+    // состояние построения между дописываниями. Последние remainder суффиксов
+    // текста еще не стали листьями - они префиксы более ранних суффиксов
+    S3_Point active;
+    long remainder;
+
+    S3_Node *nodes;
+    uint32_t size;
+    uint32_t cap;
+
+    uint32_t *tables;
+    uint32_t tableCount;
+    uint32_t tableCap;
+
+    // номер байта в сжатом алфавите; ширина таблицы - 1 << tableShift
+    uint8_t rank[ALPHABET];
+    uint32_t sigma;
+    uint32_t tableShift;
+
+    // номера листьев в порядке обхода в глубину; листья поддерева вершины v -
+    // кусок leaves[leafLo[v], leafHi[v])
+    uint32_t *leaves;
+    uint32_t *leafLo;
+    uint32_t *leafHi;
+    // наименьший номер листа в поддереве
+    uint32_t *minLeaf;
+    uint32_t leafCount;
+    // длина текста при последнем indexLeavesS3; после дописывания отрезки устарели
+    Pos indexedEnd;
+
+    // загруженное из файла дерево лежит в отображении, а не в куче
+    void *map;
+    size_t mapSize;
 } _SuffixTree, *SuffixTree;
 
+uint32_t createS3Node(SuffixTree tree, Pos start, Pos end, uint32_t leafNum);
+char getCharS3(SuffixTree tree, uint32_t node, long index);
+long lengthS3(SuffixTree tree, uint32_t node);
+uint32_t getChildS3(SuffixTree tree, uint32_t node, char key);
+void addBytesS3(SuffixTree tree, const char *text, long from, long to);
+void buildTableS3(SuffixTree tree, uint32_t node);
+void setChildS3(SuffixTree tree, uint32_t node, char key, uint32_t child);
+void printS3(SuffixTree tree, uint32_t node, long offset);
+
+char* readText(long *length);
+char* readPattern(char *buffer, long *length, long *capacity);
+
 SuffixTree buildSuffixTree(char *text, long m);
+SuffixTree createSuffixTree();
+bool appendSuffixTree(SuffixTree tree, const char *chunk, long length);
+void extendSuffixTree(SuffixTree tree, long m);
+void indexLeavesS3(SuffixTree tree);
 void deleteSuffixTree(SuffixTree tree);
 
-uint32_t* leavesDFS(S3 root, uint32_t *matches, long *matchCount, long *matchCap);
 void countingSort (uint32_t *arr, long n);
+void sortPositions(uint32_t *arr, long n);
+uint32_t locateS3(SuffixTree tree, char *pattern, long m);
+long collectMatches(SuffixTree tree, char *pattern, long m, uint32_t **matches, long *matchCap);
+long countMatches(SuffixTree tree, char *pattern, long m);
+long collectFirstMatches(SuffixTree tree, char *pattern, long m, long k, uint32_t **matches, long *matchCap);
+void printCount(long patternNum, long matchCount);
+void printMatches(long patternNum, uint32_t *matches, long matchCount);
 uint32_t* findMatches(long patternNum, SuffixTree tree, char *pattern, long m, uint32_t *matches, long *matchCap);
 
-int main() {
-    long n;
-    char *text = readText(&n);
-    
-    SuffixTree tree = buildSuffixTree(text, n);
+typedef struct SuffixArray {
+    char *text;
+    uint32_t n;
+
+    uint32_t *SA;
+    // lcp середины отрезка двоичного поиска с его левой и правой границей
+    uint32_t *Llcp;
+    uint32_t *Rlcp;
+
+    void *map;
+    size_t mapSize;
+} _SuffixArray, *SuffixArray;
+
+SuffixArray buildSuffixArray(char *text, long n);
+SuffixArray buildSuffixArrayFrom(char *text, const uint32_t *s, long n, long K);
+void deleteSuffixArray(SuffixArray sa);
+long collectMatchesSA(SuffixArray sa, char *pattern, long m, uint32_t **matches, long *matchCap);
+long countMatchesSA(SuffixArray sa, char *pattern, long m);
+long collectFirstMatchesSA(SuffixArray sa, char *pattern, long m, long k, uint32_t **matches, long *matchCap);
+uint32_t* findMatchesSA(long patternNum, SuffixArray sa, char *pattern, long m, uint32_t *matches, long *matchCap);
+
+// обобщенный суффиксный массив по набору документов
+typedef struct DocumentIndex {
+    char *text;
+    SuffixArray sa;
+    uint32_t docCount;
+    // документ суффикса SA[i]
+    uint32_t *docOf;
+    // ближайший j < i с тем же документом, плюс 1; 0 - такого нет
+    uint32_t *prevSame;
+
+    // argmin prevSame по блокам и разреженная таблица над блоками
+    uint32_t *blockMin;
+    long blockCount;
+    int levels;
+
+    // счетчики вхождений по документам, между запросами нулевые
+    uint32_t *counts;
+} _DocumentIndex, *DocumentIndex;
+
+char* readDocuments(long *length, uint32_t *docCount);
+DocumentIndex buildDocumentIndex(char *text, long n, uint32_t docCount);
+void deleteDocumentIndex(DocumentIndex index);
+long listDocuments(DocumentIndex index, char *pattern, long m, uint32_t **docs, long *docCap);
+long countDocuments(DocumentIndex index, char *pattern, long m, uint32_t **docs, uint32_t **docCounts, long *docCap);
+
+// повторы: внутренние вершины дерева - подстроки, встречающиеся хотя бы дважды
+#define LEFT_NONE -1
+// перед вхождениями разные байты (или вхождение в начале текста)
+#define LEFT_DIVERSE ALPHABET
+
+// сводка по поддереву вершины
+typedef struct RepeatInfo {
+    // длина строки от корня до вершины
+    long depth;
+    // первые вхождения в первый и во второй текст; NOT_LEAF - вхождений нет
+    uint32_t firstA;
+    uint32_t firstB;
+    long count;
+    // байт перед всеми вхождениями, LEFT_DIVERSE или LEFT_NONE у пустой сводки
+    int left;
+} RepeatInfo;
+
+typedef struct Repeats {
+    // самый длинный повтор (с двумя текстами - общая подстрока), длина 0 - нет
+    RepeatInfo longest;
+    // максимальные повторы длиной не меньше заданной
+    RepeatInfo *maximal;
+    long maximalCount;
+    long maximalCap;
+} Repeats;
+
+Repeats findRepeatsS3(SuffixTree tree, Pos split, long minLength);
+
+// заголовок файла сохраненного индекса, формат - в разделе "сохранение индекса"
+#define INDEX_MAGIC "LAB5IDX5"
+#define INDEX_SECTIONS 7
+
+enum { INDEX_TREE = 1, INDEX_ARRAY = 2 };
+
+typedef struct IndexHeader {
+    char magic[8];
+    uint32_t kind;
+    // длина текста вместе с '\n'
+    uint32_t n;
+    uint32_t nodeCount;
+    uint32_t tableCount;
+    uint32_t leafCount;
+    uint32_t sigma;
+    uint32_t tableShift;
+    uint32_t remainder;
+    uint8_t rank[ALPHABET];
+    uint64_t offsets[INDEX_SECTIONS];
+    uint64_t sizes[INDEX_SECTIONS];
+} IndexHeader;
+
+bool saveSuffixTree(SuffixTree tree, const char *path);
+bool saveSuffixArray(SuffixArray sa, const char *path);
+const IndexHeader* mapIndex(const char *path, size_t *mapSize);
+SuffixTree loadSuffixTree(const IndexHeader *header, size_t mapSize);
+SuffixArray loadSuffixArray(const IndexHeader *header, size_t mapSize);
+
+// что выводить на паттерн: все вхождения, только их число или k первых
+typedef enum QueryKind { QUERY_ALL, QUERY_COUNT, QUERY_FIRST } QueryKind;
+
+typedef struct QueryMode {
+    QueryKind kind;
+    long k;
+} QueryMode;
+
+long answerQuery(SuffixTree tree, SuffixArray sa, QueryMode mode, char *pattern, long m, uint32_t **matches, long *matchCap);
+void batchQueries(SuffixTree tree, SuffixArray sa, QueryMode mode, int threads);
+int queryDocuments(QueryMode mode);
+int queryOnline(QueryMode mode);
+int queryRepeats(long minLength);
+
+// ./app.out               - текст в первой строке stdin, дальше паттерны по одному в строке
+// ./app.out -a            - то же, но поиск по суффиксному массиву вместо дерева
+// ./app.out -s index.bin  - дополнительно сохранить построенный индекс (можно вместе с -a)
+// ./app.out -l index.bin  - взять готовый индекс из файла, в stdin только паттерны
+// ./app.out -j N          - прочитать все паттерны сразу и искать в N потоков (0 - по числу ядер)
+// ./app.out -c            - печатать только число вхождений
+// ./app.out -k K          - печатать только K первых вхождений
+// ./app.out -o            - строки вида ">кусок" дописывают кусок к тексту, остальные - паттерны
+//                           по тексту, набранному к этому моменту
+// ./app.out -d            - документы по одному в строке до пустой строки, дальше паттерны;
+//                           печатаются номера документов с вхождениями (с -c - и число вхождений)
+// ./app.out -r L          - в первой строке текст, во второй (можно пустой) - второй текст;
+//                           печатается самый длинный повтор (общая подстрока двух текстов)
+//                           и максимальные повторы длиной от L
+int main(int argc, char **argv) {
+    bool useArray = false;
+    bool useDocuments = false;
+    bool online = false;
+    const char *savePath = NULL;
+    const char *loadPath = NULL;
+    int threads = -1;
+    long minRepeat = -1;
+    QueryMode mode = {QUERY_ALL, 0};
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-a") == 0) useArray = true;
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) savePath = argv[++i];
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) loadPath = argv[++i];
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-c") == 0) mode.kind = QUERY_COUNT;
+        else if (strcmp(argv[i], "-d") == 0) useDocuments = true;
+        else if (strcmp(argv[i], "-o") == 0) online = true;
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) minRepeat = atol(argv[++i]);
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+            mode.kind = QUERY_FIRST;
+            mode.k = atol(argv[++i]);
+        }
+    }
+
+    if (useDocuments) return queryDocuments(mode);
+    if (online) return queryOnline(mode);
+    if (minRepeat >= 0) return queryRepeats(minRepeat);
+
+    char *text = NULL;
+    SuffixTree tree = NULL;
+    SuffixArray sa = NULL;
+
+    if (loadPath != NULL) {
+        size_t mapSize;
+        const IndexHeader *header = mapIndex(loadPath, &mapSize);
+        if (header == NULL) {
+            fprintf(stderr, "%s: not an index file\n", loadPath);
+            return 1;
+        }
+
+        useArray = header->kind == INDEX_ARRAY;
+        if (useArray) sa = loadSuffixArray(header, mapSize);
+        else tree = loadSuffixTree(header, mapSize);
+    } else {
+        long n;
+        text = readText(&n);
+
+        if (n >= UINT32_MAX) {
+            fprintf(stderr, "text is too long\n");
+            free(text);
+            return 1;
+        }
+
+        if (useArray) sa = buildSuffixArray(text, n);
+        else tree = buildSuffixTree(text, n);
+
+        bool saved = savePath == NULL || (useArray ? saveSuffixArray(sa, savePath) : saveSuffixTree(tree, savePath));
+        if (!saved) perror(savePath);
+    }
 
     long cap = 0;
     long m = 0;
@@ -79,140 +333,181 @@ int main() {
     long matchCap = 0;
     uint32_t *matches = NULL;
 
-    while (1) {
+    if (threads >= 0) batchQueries(tree, sa, mode, threads);
+
+    while (threads < 0) {
         m = 0;
         pattern = readPattern(pattern, &m, &cap);
         if (feof(stdin) || m == 0) break;
         patternNum++;
 
-        matches = findMatches(patternNum, tree, pattern, m, matches, &matchCap);
+        if (mode.kind == QUERY_ALL) {
+            if (useArray) matches = findMatchesSA(patternNum, sa, pattern, m, matches, &matchCap);
+            else matches = findMatches(patternNum, tree, pattern, m, matches, &matchCap);
+            continue;
+        }
+
+        long matchCount = answerQuery(tree, sa, mode, pattern, m, &matches, &matchCap);
+        if (mode.kind == QUERY_COUNT) printCount(patternNum, matchCount);
+        else printMatches(patternNum, matches, matchCount);
     }
-    
+
     free(matches);
     free(pattern);
-    deleteSuffixTree(tree);
+    if (useArray) deleteSuffixArray(sa);
+    else deleteSuffixTree(tree);
     free(text);
 
     return 0;
 }
 
-void initMap(Map *map) {
-    map->size = 0;
-    map->cap = EXTEND_SIZE;
-    map->items = (Pair*)malloc(sizeof(Pair) * EXTEND_SIZE);
-
-    for (int i = 0; i < map->cap; i++) {
-        map->items[i].key = '\0';
-        map->items[i].value = NULL;
+uint32_t createS3Node(SuffixTree tree, Pos start, Pos end, uint32_t leafNum) {
+    if (tree->size >= tree->cap) {
+        tree->cap *= 2;
+        tree->nodes = realloc(tree->nodes, sizeof(S3_Node) * tree->cap);
     }
-} 
 
-void setMap(Map *map, char key, struct S3_Node *value) {
-    if (map->cap / 4 * 3 <= map->size) {
-        extendMap(map);
-    }
-    
-    unsigned char hash = (unsigned char)key % map->cap;
+    uint32_t res = tree->size++;
+    S3_Node *node = &tree->nodes[res];
 
-    while (map->items[hash].key != key) {
-        if (map->items[hash].key == '\0') break;
-        hash = (hash + 1) % map->cap;
-    }
-    
-    if (map->items[hash].key == '\0') map->size++;
-    map->items[hash].key = key;
-    map->items[hash].value = value;
+    node->start = start;
+    node->end = end;
+    node->leafNum = leafNum;
+    node->suffixLink = NO_NODE;
+    node->firstChild = NO_NODE;
+    node->nextSibling = NO_NODE;
+    node->table = NO_TABLE;
+    // у корня нет входящего ребра, а текст онлайн-дерева в этот момент еще пуст
+    node->key = res == ROOT ? 0 : tree->text[start];
+
+    if (leafNum == NOT_LEAF && tree->sigma <= DIRECT_SIGMA) buildTableS3(tree, res);
+
+    return res;
 }
 
-struct S3_Node* getMap(Map *map, char key) {
-    unsigned char hash = (unsigned char)(key) % map->cap;
+char getCharS3(SuffixTree tree, uint32_t node, long index) {
+    return tree->text[tree->nodes[node].start + index];
+}
+
+long lengthS3(SuffixTree tree, uint32_t node) {
+    S3_Node *it = &tree->nodes[node];
 
-    int counter = 0;
-    while (map->items[hash].key != key && counter < map->cap) {
-        if (map->items[hash].key == '\0') return NULL;
-        hash = (hash + 1) % map->cap;
-        counter++;
+    if (it->leafNum == NOT_LEAF) {
+        return it->end - it->start;
     }
 
-    if (map->items[hash].key != key) return NULL;
-    return map->items[hash].value;
+    return tree->end - it->start;
 }
 
-void extendMap(Map *map) {
-    unsigned char newCap = map->cap + EXTEND_SIZE;
-    if (256 - map->cap <= EXTEND_SIZE) newCap = 255;
-    
-    Pair *newItems = (Pair*)malloc(sizeof(Pair) * newCap);
+uint32_t getChildS3(SuffixTree tree, uint32_t node, char key) {
+    S3_Node *it = &tree->nodes[node];
 
-    for (int i = 0; i < newCap; i++) {
-        newItems[i].key = '\0';
-        newItems[i].value = NULL;
+    if (it->table != NO_TABLE) {
+        return tree->tables[((size_t)it->table << tree->tableShift) | tree->rank[(unsigned char)key]];
     }
 
-    for (int i = 0; i < map->cap; i++) {
-        Pair item = map->items[i];
-        if (item.key == '\0') continue;
-        unsigned char hash = (unsigned char)(item.key) % newCap;
+    uint32_t child = it->firstChild;
+    while (child != NO_NODE && (unsigned char)tree->nodes[child].key < (unsigned char)key) {
+        child = tree->nodes[child].nextSibling;
+    }
 
-        while (newItems[hash].key != '\0') {
-            hash = (hash + 1) % newCap;
-        }
-        
-        newItems[hash] = item;
+    if (child == NO_NODE || tree->nodes[child].key != key) return NO_NODE;
+    return child;
+}
+
+// таблицы становятся шире: строки переносятся на новые места, новые ячейки пустые
+void widenTablesS3(SuffixTree tree) {
+    size_t oldWidth = (size_t)1 << tree->tableShift;
+    size_t width = oldWidth * 2;
+
+    uint32_t *tables = malloc(sizeof(uint32_t) * width * (tree->tableCap > 0 ? tree->tableCap : 1));
+    for (size_t t = 0; t < tree->tableCount; t++) {
+        memcpy(tables + t * width, tree->tables + t * oldWidth, sizeof(uint32_t) * oldWidth);
+        for (size_t i = oldWidth; i < width; i++) tables[t * width + i] = NO_NODE;
     }
 
-    free(map->items);
-    map->items = newItems;
-    map->cap = newCap;
+    free(tree->tables);
+    tree->tables = tables;
+    tree->tableShift++;
 }
 
-void deleteMap(Map *map, void (*destructor)(struct S3_Node*)) {
-    for (int i = 0; i < map->cap; i++) {
-        if (map->items[i].value != NULL) {
-            destructor(map->items[i].value);
+// Нумерует новые байты text[from, to) в порядке появления. Номер-заглушка
+// отсутствующих байт - последняя ячейка таблицы, поэтому ширина - степень
+// двойки не меньше sigma + 1 (кроме полного алфавита, где заглушка не нужна)
+void addBytesS3(SuffixTree tree, const char *text, long from, long to) {
+    for (long i = from; i < to; i++) {
+        unsigned char c = text[i];
+        uint32_t absent = (1u << tree->tableShift) - 1;
+
+        // у полного алфавита заглушки нет, все байты уже пронумерованы
+        if (tree->sigma == ALPHABET || tree->rank[c] != absent) continue;
+
+        uint32_t width = tree->sigma + 1 < ALPHABET ? tree->sigma + 2 : ALPHABET;
+        if (width > (1u << tree->tableShift)) {
+            widenTablesS3(tree);
+            for (int b = 0; b < ALPHABET; b++) {
+                if (tree->rank[b] == absent) tree->rank[b] = (1u << tree->tableShift) - 1;
+            }
         }
-    }
 
-    free(map->items);
+        tree->rank[c] = tree->sigma++;
+    }
 }
 
-S3 createS3Node(Pos start, Pos end, uint32_t leafNum) {
-    S3 res = malloc(sizeof(S3_Node));
+void buildTableS3(SuffixTree tree, uint32_t node) {
+    size_t width = (size_t)1 << tree->tableShift;
 
-    res->start = start;
-    if (leafNum == NOT_LEAF) {
-        res->end.letter = end;          
-    } else {
-        res->end.ptr = (Pos*) end;       
+    if (tree->tableCount >= tree->tableCap) {
+        tree->tableCap = tree->tableCap == 0 ? 16 : tree->tableCap * 2;
+        tree->tables = realloc(tree->tables, sizeof(uint32_t) * width * tree->tableCap);
     }
-    res->leafNum = leafNum;
-    res->suffixLink = NULL;
 
-    initMap(&res->children);
+    uint32_t table = tree->tableCount++;
+    uint32_t *slots = tree->tables + table * width;
 
-    return res;
-}
+    for (size_t i = 0; i < width; i++) slots[i] = NO_NODE;
+
+    for (uint32_t child = tree->nodes[node].firstChild; child != NO_NODE; child = tree->nodes[child].nextSibling) {
+        slots[tree->rank[(unsigned char)tree->nodes[child].key]] = child;
+    }
 
-char getCharS3(S3 node, long index) {
-    return *(node->start + index);
+    tree->nodes[node].table = table;
 }
 
-long lengthS3(S3 node) {
-    if (node->leafNum == NOT_LEAF) {
-        return node->end.letter - node->start;
+// ставит child ребенком node по букве key, заменяя прежнего ребенка с этой буквой
+void setChildS3(SuffixTree tree, uint32_t node, char key, uint32_t child) {
+    S3_Node *nodes = tree->nodes;
+    uint32_t *link = &nodes[node].firstChild;
+    uint32_t count = 0;
+
+    while (*link != NO_NODE && (unsigned char)nodes[*link].key < (unsigned char)key) {
+        link = &nodes[*link].nextSibling;
+        count++;
     }
 
-    Pos end = *node->end.ptr;
-    return end - node->start;
-}
+    if (*link != NO_NODE && nodes[*link].key == key) {
+        nodes[child].nextSibling = nodes[*link].nextSibling;
+    } else {
+        nodes[child].nextSibling = *link;
+        count++;
+    }
+    *link = child;
+
+    if (nodes[node].table != NO_TABLE) {
+        tree->tables[((size_t)nodes[node].table << tree->tableShift) | tree->rank[(unsigned char)key]] = child;
+        return;
+    }
+
+    // дошли только до места вставки - досчитываем остальных детей
+    for (uint32_t it = nodes[child].nextSibling; it != NO_NODE && count <= DENSE_FANOUT; it = nodes[it].nextSibling) {
+        count++;
+    }
 
-void deleteS3(S3 node) {
-    deleteMap(&node->children, deleteS3);
-    free(node);
+    if (count > DENSE_FANOUT) buildTableS3(tree, node);
 }
 
-void printS3(S3 node, long offset) {
-    if (node->start == NULL) {
+void printNodeS3(SuffixTree tree, uint32_t node, long offset) {
+    if (node == ROOT) {
         printf("ROOT");
     }
 
@@ -220,22 +515,50 @@ void printS3(S3 node, long offset) {
         printf("--");
     }
 
-    for (int i = 0; i < lengthS3(node); i++) {
-        char letter = getCharS3(node, i);
+    for (int i = 0; i < lengthS3(tree, node); i++) {
+        char letter = getCharS3(tree, node, i);
         printf("%c", letter != '\n' ? letter : '$');
     }
 
-    if (node->leafNum != NOT_LEAF) {
-        printf(" [%d]", node->leafNum);
+    if (tree->nodes[node].leafNum != NOT_LEAF) {
+        printf(" [%d]", tree->nodes[node].leafNum);
     }
 
     printf("\n");
+}
+
+// поддерево node в прямом порядке; стек явный, как в indexLeavesS3
+void printS3(SuffixTree tree, uint32_t node, long offset) {
+    // на каждом уровне - следующий ребенок, которого печатать
+    uint32_t *stack = malloc(sizeof(uint32_t) * POOL_START_CAP);
+    long stackCap = POOL_START_CAP;
+    long depth = 0;
+
+    printNodeS3(tree, node, offset);
+    stack[depth++] = tree->nodes[node].firstChild;
+
+    while (depth > 0) {
+        uint32_t child = stack[depth - 1];
+
+        if (child == NO_NODE) {
+            depth--;
+            continue;
+        }
+
+        stack[depth - 1] = tree->nodes[child].nextSibling;
+        printNodeS3(tree, child, offset + depth);
 
-    for (int i = 0; i < node->children.cap; i++) {
-        if (node->children.items[i].value != NULL) {
-            printS3(node->children.items[i].value, offset + 1);
+        if (tree->nodes[child].leafNum != NOT_LEAF) continue;
+
+        if (depth >= stackCap) {
+            stackCap *= 2;
+            stack = realloc(stack, sizeof(uint32_t) * stackCap);
         }
+
+        stack[depth++] = tree->nodes[child].firstChild;
     }
+
+    free(stack);
 }
 
 char* readText(long *length) {
@@ -244,7 +567,7 @@ char* readText(long *length) {
     long cap = EXTEND_SIZE;
 
     while (1) {
-        char letter = fgetc(stdin);
+        int letter = fgetc(stdin);
         if (letter == '\r') continue;
 
         if (letter == '\n' || letter == EOF) {
@@ -263,32 +586,104 @@ char* readText(long *length) {
             break;
         }
     }
-    
+
     *length = size;
     return buffer;
 }
 
-SuffixTree buildSuffixTree(char *text, long m) {
+// пустое дерево над text; байты text[0, m) сразу попадают в алфавит
+SuffixTree newSuffixTree(char *text, long textCap, long m) {
     SuffixTree tree = (SuffixTree)malloc(sizeof(_SuffixTree));
-    tree->root = createS3Node(NULL, NULL, NOT_LEAF);
-    tree->root->suffixLink = tree->root;
-    tree->end = NULL;
+    tree->text = text;
+    tree->end = 0;
+    tree->textCap = textCap;
+
+    // вершин не больше 2m, обычно около 1.6m
+    tree->cap = m > POOL_START_CAP ? m + m / 2 : POOL_START_CAP;
+    tree->nodes = malloc(sizeof(S3_Node) * tree->cap);
+    tree->size = 0;
+    tree->tables = NULL;
+    tree->tableCount = 0;
+    tree->tableCap = 0;
+    tree->leaves = NULL;
+    tree->leafLo = NULL;
+    tree->leafHi = NULL;
+    tree->minLeaf = NULL;
+    tree->leafCount = 0;
+    tree->indexedEnd = 0;
+    tree->map = NULL;
+    tree->mapSize = 0;
+
+    // пока байтов нет, все получают заглушку 0 в таблицах ширины 1
+    memset(tree->rank, 0, sizeof(tree->rank));
+    tree->sigma = 0;
+    tree->tableShift = 0;
+    addBytesS3(tree, text, 0, m);
+
+    createS3Node(tree, 0, 0, NOT_LEAF);
+    tree->nodes[ROOT].suffixLink = ROOT;
+
+    S3_Point start = {ROOT, 0, 0};
+    tree->active = start;
+    tree->remainder = 0;
+
+    return tree;
+}
 
-    struct {
-        S3 node;
-        Pos edge;
-        long length;
-    } active = {tree->root, text, 0};
+SuffixTree buildSuffixTree(char *text, long m) {
+    SuffixTree tree = newSuffixTree(text, 0, m);
 
-    long remainder = 0;
-    S3 lastCreatedNode = NULL;
+    extendSuffixTree(tree, m);
+    indexLeavesS3(tree);
 
-    for (long i = 0; i < m; i++) {
-        Pos pos = text + i;
+    return tree;
+}
+
+// дерево для дописывания, текст хранит само
+SuffixTree createSuffixTree() {
+    return newSuffixTree(malloc(EXTEND_SIZE), EXTEND_SIZE, 0);
+}
+
+// Дописывает chunk к тексту и продолжает построение с сохраненной активной точки.
+// Номера позиций не меняются, поэтому буфер текста можно расширять realloc'ом.
+// false, если дерево загружено из файла или текст стал бы слишком длинным
+bool appendSuffixTree(SuffixTree tree, const char *chunk, long length) {
+    if (tree->map != NULL || (uint64_t)tree->end + length >= UINT32_MAX) return false;
+
+    long need = tree->end + length;
+
+    if (tree->textCap == 0) {
+        // текст был чужой - дальше работаем с копией
+        long cap = need * 2 > EXTEND_SIZE ? need * 2 : EXTEND_SIZE;
+        char *text = malloc(cap);
+        memcpy(text, tree->text, tree->end);
+        tree->text = text;
+        tree->textCap = cap;
+    } else if (need > tree->textCap) {
+        tree->textCap = need * 2;
+        tree->text = realloc(tree->text, tree->textCap);
+    }
+
+    memcpy(tree->text + tree->end, chunk, length);
+    addBytesS3(tree, tree->text, tree->end, need);
+    extendSuffixTree(tree, need);
+
+    return true;
+}
+
+// фазы Укконена для text[tree->end, m)
+void extendSuffixTree(SuffixTree tree, long m) {
+    char *text = tree->text;
+    S3_Point active = tree->active;
+    long remainder = tree->remainder;
+    uint32_t lastCreatedNode = NO_NODE;
+
+    for (long i = tree->end; i < m; i++) {
+        Pos pos = i;
         // правило 1
         tree->end = pos + 1;
 
-        lastCreatedNode = NULL;
+        lastCreatedNode = NO_NODE;
         remainder++;
 
         while (remainder > 0) {
@@ -296,34 +691,35 @@ SuffixTree buildSuffixTree(char *text, long m) {
                 active.edge = pos;
             }
 
-            char currentChar = *active.edge;
-            S3 it = getMap(&active.node->children, currentChar);
+            char currentChar = text[active.edge];
+            uint32_t it = getChildS3(tree, active.node, currentChar);
 
-            if (it == NULL) {
-                S3 leaf = createS3Node(pos, (Pos)(&tree->end), i - remainder + 1);
-                setMap(&active.node->children, currentChar, leaf);
+            if (it == NO_NODE) {
+                uint32_t leaf = createS3Node(tree, pos, 0, i - remainder + 1);
+                setChildS3(tree, active.node, currentChar, leaf);
 
                 // проводим суффиксную ссылку
-                if (lastCreatedNode != NULL) {
-                    lastCreatedNode->suffixLink = active.node;
+                if (lastCreatedNode != NO_NODE) {
+                    tree->nodes[lastCreatedNode].suffixLink = active.node;
                 }
                 lastCreatedNode = active.node;
             } else {
                 // прыжки по счетчику
-                if (active.length >= lengthS3(it)) {
-                    active.edge += lengthS3(it);
-                    active.length -= lengthS3(it);
+                long edgeLength = lengthS3(tree, it);
+                if (active.length >= edgeLength) {
+                    active.edge += edgeLength;
+                    active.length -= edgeLength;
                     active.node = it;
                     continue;
                 }
 
                 // правило 3
-                if (*(it->start + active.length) == *pos) {
+                if (getCharS3(tree, it, active.length) == text[pos]) {
                     active.length++;
-                    
+
                     // проводим суффиксную ссылку
-                    if (lastCreatedNode != NULL) {
-                        lastCreatedNode->suffixLink = active.node;
+                    if (lastCreatedNode != NO_NODE) {
+                        tree->nodes[lastCreatedNode].suffixLink = active.node;
                     }
                     lastCreatedNode = active.node;
 
@@ -331,27 +727,31 @@ SuffixTree buildSuffixTree(char *text, long m) {
                 }
 
                 // правило 2
-                Pos splitEnd = it->start + active.length;
-                S3 splitNode = createS3Node(it->start, splitEnd, NOT_LEAF);
+                Pos itStart = tree->nodes[it].start;
+                uint32_t splitNode = createS3Node(tree, itStart, itStart + active.length, NOT_LEAF);
 
-                it->start += active.length;
-                S3 leaf = createS3Node(pos, (Pos)(&tree->end), i - remainder + 1);
+                uint32_t leaf = createS3Node(tree, pos, 0, i - remainder + 1);
+
+                // сначала вынимаем it из списка active.node, пока его ключ прежний
+                setChildS3(tree, active.node, currentChar, splitNode);
+
+                tree->nodes[it].start += active.length;
+                tree->nodes[it].key = text[tree->nodes[it].start];
+                setChildS3(tree, splitNode, tree->nodes[it].key, it);
+                setChildS3(tree, splitNode, text[pos], leaf);
 
-                setMap(&active.node->children, currentChar, splitNode);
-                setMap(&splitNode->children, *it->start, it);
-                setMap(&splitNode->children, *pos, leaf);
-                
                 // проводим суффиксную ссылку
-                if (lastCreatedNode != NULL) {
-                    lastCreatedNode->suffixLink = splitNode;
+                if (lastCreatedNode != NO_NODE) {
+                    tree->nodes[lastCreatedNode].suffixLink = splitNode;
                 }
                 lastCreatedNode = splitNode;
             }
 
             remainder--;
 
-            if (active.node != tree->root) {
-                active.node = (active.node->suffixLink != NULL) ? active.node->suffixLink : tree->root;
+            if (active.node != ROOT) {
+                uint32_t link = tree->nodes[active.node].suffixLink;
+                active.node = (link != NO_NODE) ? link : ROOT;
                 continue;
             }
 
@@ -362,11 +762,95 @@ SuffixTree buildSuffixTree(char *text, long m) {
         }
     }
 
-    return tree;
+    tree->active = active;
+    tree->remainder = remainder;
+}
+
+// Обход в глубину после построения: листья выписываются подряд, и у каждой
+// вершины запоминается ее отрезок. Тогда вхождения паттерна - готовый кусок
+// массива, а не обход поддерева на каждый запрос. Заодно считаем наименьший
+// лист поддерева - по нему ищутся первые вхождения. Стек явный, потому что
+// глубина дерева на повторяющемся тексте - O(n).
+void indexLeavesS3(SuffixTree tree) {
+    S3_Node *nodes = tree->nodes;
+
+    tree->leaves = realloc(tree->leaves, sizeof(uint32_t) * (tree->end > 0 ? tree->end : 1));
+    tree->leafLo = realloc(tree->leafLo, sizeof(uint32_t) * tree->size);
+    tree->leafHi = realloc(tree->leafHi, sizeof(uint32_t) * tree->size);
+    tree->minLeaf = realloc(tree->minLeaf, sizeof(uint32_t) * tree->size);
+    uint32_t *minLeaf = tree->minLeaf;
+
+    struct Frame {
+        uint32_t node;
+        // следующий ребенок, в которого спускаться
+        uint32_t child;
+    } *stack = malloc(sizeof(struct Frame) * POOL_START_CAP);
+    long stackCap = POOL_START_CAP;
+    long depth = 0;
+
+    uint32_t leafCount = 0;
+
+    tree->leafLo[ROOT] = 0;
+    minLeaf[ROOT] = NOT_LEAF;
+    stack[depth].node = ROOT;
+    stack[depth].child = nodes[ROOT].firstChild;
+    depth++;
+
+    while (depth > 0) {
+        struct Frame *top = &stack[depth - 1];
+
+        if (top->child == NO_NODE) {
+            tree->leafHi[top->node] = leafCount;
+            depth--;
+
+            if (depth > 0 && minLeaf[top->node] < minLeaf[stack[depth - 1].node]) {
+                minLeaf[stack[depth - 1].node] = minLeaf[top->node];
+            }
+            continue;
+        }
+
+        uint32_t child = top->child;
+        top->child = nodes[child].nextSibling;
+        tree->leafLo[child] = leafCount;
+
+        if (nodes[child].leafNum != NOT_LEAF) {
+            tree->leaves[leafCount++] = nodes[child].leafNum;
+            tree->leafHi[child] = leafCount;
+
+            minLeaf[child] = nodes[child].leafNum;
+            if (minLeaf[child] < minLeaf[top->node]) minLeaf[top->node] = minLeaf[child];
+            continue;
+        }
+
+        if (depth >= stackCap) {
+            stackCap *= 2;
+            stack = realloc(stack, sizeof(struct Frame) * stackCap);
+        }
+
+        minLeaf[child] = NOT_LEAF;
+        stack[depth].node = child;
+        stack[depth].child = nodes[child].firstChild;
+        depth++;
+    }
+
+    tree->leafCount = leafCount;
+    tree->indexedEnd = tree->end;
+    free(stack);
 }
 
+// вершины лежат в пуле - освобождаем его целиком, без обхода
 void deleteSuffixTree(SuffixTree tree) {
-    deleteS3(tree->root);
+    if (tree->map != NULL) {
+        munmap(tree->map, tree->mapSize);
+    } else {
+        free(tree->nodes);
+        free(tree->tables);
+        free(tree->leaves);
+        free(tree->leafLo);
+        free(tree->leafHi);
+        free(tree->minLeaf);
+        if (tree->textCap > 0) free(tree->text);
+    }
     free(tree);
 }
 
@@ -375,51 +859,28 @@ char* readPattern(char *buffer, long *length, long *capacity) {
     long cap = *capacity;
 
     while (1) {
-        char letter = fgetc(stdin);
+        int letter = fgetc(stdin);
         if (letter == '\r') continue;
 
-        if (letter == '\n' || letter == EOF) {
-            letter = '\0';
-        }
+        // нулевой байт может быть частью паттерна, конец - только перевод строки
+        bool end = letter == '\n' || letter == EOF;
 
         if (size >= cap) {
             cap += EXTEND_SIZE;
             buffer = realloc(buffer, cap);
         }
 
-        buffer[size] = letter;
+        buffer[size] = end ? '\0' : letter;
 
-        if (letter == '\0') break;
+        if (end) break;
         size++;
     }
-    
+
     *length = size;
     *capacity = cap;
     return buffer;
 }
 
-uint32_t* leavesDFS(S3 root, uint32_t *matches, long *matchCount, long *matchCap) {
-    if (root->leafNum != NOT_LEAF) {
-        if (*matchCount >= *matchCap) {
-            *matchCap += EXTEND_SIZE;
-            long newSize = (*matchCap) * sizeof(uint32_t);
-            matches = (uint32_t*)realloc(matches, newSize);
-        }
-
-        matches[*matchCount] = root->leafNum;
-        (*matchCount)++;
-        return matches;
-    }
-
-    for (uint8_t i = 0; i < root->children.cap; i++) {
-        if (root->children.items[i].key != '\0') {
-            matches = leavesDFS(root->children.items[i].value, matches, matchCount, matchCap);
-        }
-    }
-
-    return matches;
-}
-
 void countingSort (uint32_t *arr, long n) {
     uint32_t min = arr[0], max = arr[0];
 
@@ -429,14 +890,14 @@ void countingSort (uint32_t *arr, long n) {
     }
 
     uint32_t range = max - min + 1;
-    
+
     uint32_t *counts = malloc(sizeof(uint32_t) * range);
     for (long i = 0; i < range; i++) counts[i] = 0;
-    
+
     for (long i = 0; i < n; i++) counts[arr[i] - min]++;
 
     long it = 0;
-    
+
     for (uint32_t i = 0; i < range; i++) {
         for (uint32_t j = 0; j < counts[i]; j++) {
             arr[it++] = i + min;
@@ -446,8 +907,66 @@ void countingSort (uint32_t *arr, long n) {
     free(counts);
 }
 
-uint32_t* findMatches(long patternNum, SuffixTree tree, char *pattern, long m, uint32_t *matches, long *matchCap) {
-    S3 currentNode = tree->root;
+// LSD по RADIX_BITS бит; проходов столько, сколько цифр в max - min
+void radixSort(uint32_t *arr, long n, uint32_t min, uint32_t max) {
+    uint32_t *buffer = malloc(sizeof(uint32_t) * n);
+    uint32_t *from = arr;
+    uint32_t *to = buffer;
+    long counts[1 << RADIX_BITS];
+    uint32_t mask = (1 << RADIX_BITS) - 1;
+
+    for (int shift = 0; shift < 32 && ((max - min) >> shift) != 0; shift += RADIX_BITS) {
+        memset(counts, 0, sizeof(counts));
+        for (long i = 0; i < n; i++) counts[((from[i] - min) >> shift) & mask]++;
+
+        long sum = 0;
+        for (int d = 0; d <= (int)mask; d++) {
+            long count = counts[d];
+            counts[d] = sum;
+            sum += count;
+        }
+
+        for (long i = 0; i < n; i++) to[counts[((from[i] - min) >> shift) & mask]++] = from[i];
+
+        uint32_t *tmp = from;
+        from = to;
+        to = tmp;
+    }
+
+    if (from != arr) memcpy(arr, from, sizeof(uint32_t) * n);
+    free(buffer);
+}
+
+// номера вхождений разные; подсчет выгоден, только если они лежат плотно
+void sortPositions(uint32_t *arr, long n) {
+    if (n < 2) return;
+
+    if (n <= INSERTION_SORT_MAX) {
+        for (long i = 1; i < n; i++) {
+            uint32_t item = arr[i];
+            long j = i;
+            while (j > 0 && arr[j - 1] > item) {
+                arr[j] = arr[j - 1];
+                j--;
+            }
+            arr[j] = item;
+        }
+        return;
+    }
+
+    uint32_t min = arr[0], max = arr[0];
+    for (long i = 1; i < n; i++) {
+        if (arr[i] < min) min = arr[i];
+        if (arr[i] > max) max = arr[i];
+    }
+
+    if ((uint64_t)(max - min) < (uint64_t)COUNTING_RANGE_FACTOR * n) countingSort(arr, n);
+    else radixSort(arr, n, min, max);
+}
+
+// вершина, в поддереве которой лежат все вхождения паттерна; NO_NODE, если их нет
+uint32_t locateS3(SuffixTree tree, char *pattern, long m) {
+    uint32_t currentNode = ROOT;
     long edgeLength = 0;
     long edgePos = 0;
 
@@ -456,33 +975,1549 @@ uint32_t* findMatches(long patternNum, SuffixTree tree, char *pattern, long m, u
 
         if (edgePos >= edgeLength) {
             // мы в вершине, пытаемся перейти на следующее ребро
-            currentNode = getMap(&currentNode->children, patternLetter);
+            currentNode = getChildS3(tree, currentNode, patternLetter);
 
             // не смогли перейти => паттерна нет в тексте
-            if (currentNode == NULL) return matches;
+            if (currentNode == NO_NODE) return NO_NODE;
 
             edgePos = 1;
-            edgeLength = lengthS3(currentNode);
+            edgeLength = lengthS3(tree, currentNode);
         } else {
             // мы на ребре, пытаемся продвинуться по нему
             // не смогли пройти => паттерна нет в тексте
-            if (patternLetter != getCharS3(currentNode, edgePos)) return matches;
+            if (patternLetter != getCharS3(tree, currentNode, edgePos)) return NO_NODE;
 
             edgePos++;
         }
     }
 
-    // если дошли до сюда - есть вхождение
-    long matchCount = 0;
-    matches = leavesDFS(currentNode, matches, &matchCount, matchCap);
+    return currentNode;
+}
+
+bool leavesIndexedS3(SuffixTree tree) {
+    return tree->leaves != NULL && tree->indexedEnd == tree->end;
+}
+
+// Номера листьев поддерева node в *matches (без порядка), возвращает их число.
+// Если после indexLeavesS3 текст дописывали, отрезки устарели - обходим поддерево.
+// matches == NULL - только посчитать
+long subtreeLeavesS3(SuffixTree tree, uint32_t node, uint32_t **matches, long *matchCap) {
+    if (leavesIndexedS3(tree)) {
+        long from = tree->leafLo[node];
+        long count = tree->leafHi[node] - from;
+        if (matches == NULL) return count;
+
+        if (count > *matchCap) {
+            *matchCap = count;
+            *matches = realloc(*matches, sizeof(uint32_t) * count);
+        }
+
+        memcpy(*matches, tree->leaves + from, sizeof(uint32_t) * count);
+        return count;
+    }
+
+    long stackCap = 64;
+    uint32_t *stack = malloc(sizeof(uint32_t) * stackCap);
+    long depth = 0;
+    long count = 0;
+
+    stack[depth++] = node;
+
+    while (depth > 0) {
+        uint32_t it = stack[--depth];
+
+        if (tree->nodes[it].leafNum != NOT_LEAF) {
+            if (matches != NULL) {
+                if (count >= *matchCap) {
+                    *matchCap = *matchCap * 2 + 16;
+                    *matches = realloc(*matches, sizeof(uint32_t) * *matchCap);
+                }
+                (*matches)[count] = tree->nodes[it].leafNum;
+            }
+            count++;
+            continue;
+        }
+
+        for (uint32_t child = tree->nodes[it].firstChild; child != NO_NODE; child = tree->nodes[child].nextSibling) {
+            if (depth >= stackCap) {
+                stackCap *= 2;
+                stack = realloc(stack, sizeof(uint32_t) * stackCap);
+            }
+            stack[depth++] = child;
+        }
+    }
+
+    free(stack);
+    return count;
+}
+
+// Вхождения среди последних remainder суффиксов, которые еще не листья; они правее
+// всех листьев, поэтому дописываются в конец. Не больше limit штук, всего - до count
+long pendingMatchesS3(SuffixTree tree, char *pattern, long m, uint32_t **matches, long count, long limit, long *matchCap) {
+    for (long j = tree->end - tree->remainder; j < tree->end && count < limit; j++) {
+        if (j + m > tree->end || memcmp(tree->text + j, pattern, m) != 0) continue;
+
+        if (matches != NULL) {
+            if (count >= *matchCap) {
+                *matchCap = *matchCap * 2 + 16;
+                *matches = realloc(*matches, sizeof(uint32_t) * *matchCap);
+            }
+            (*matches)[count] = j;
+        }
+        count++;
+    }
+
+    return count;
+}
+
+// собирает в *matches отсортированные номера вхождений, возвращает их количество
+long collectMatches(SuffixTree tree, char *pattern, long m, uint32_t **matches, long *matchCap) {
+    uint32_t node = locateS3(tree, pattern, m);
+    if (node == NO_NODE) return 0;
+
+    // вхождения - листья поддерева node и, у недостроенного дерева, часть хвостовых суффиксов
+    long matchCount = subtreeLeavesS3(tree, node, matches, matchCap);
+    sortPositions(*matches, matchCount);
+
+    return pendingMatchesS3(tree, pattern, m, matches, matchCount, LONG_MAX, matchCap);
+}
+
+// O(m): число вхождений - длина отрезка листьев
+long countMatches(SuffixTree tree, char *pattern, long m) {
+    uint32_t node = locateS3(tree, pattern, m);
+    if (node == NO_NODE) return 0;
+
+    long matchCount = subtreeLeavesS3(tree, node, NULL, NULL);
+    return pendingMatchesS3(tree, pattern, m, NULL, matchCount, LONG_MAX, NULL);
+}
+
+// куча вершин по возрастанию minLeaf
+void siftUpS3(SuffixTree tree, uint32_t *heap, long i) {
+    uint32_t item = heap[i];
+
+    while (i > 0 && tree->minLeaf[heap[(i - 1) / 2]] > tree->minLeaf[item]) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+
+    heap[i] = item;
+}
+
+void siftDownS3(SuffixTree tree, uint32_t *heap, long size) {
+    uint32_t item = heap[0];
+    long i = 0;
+
+    while (2 * i + 1 < size) {
+        long child = 2 * i + 1;
+        if (child + 1 < size && tree->minLeaf[heap[child + 1]] < tree->minLeaf[heap[child]]) child++;
+        if (tree->minLeaf[heap[child]] >= tree->minLeaf[item]) break;
+
+        heap[i] = heap[child];
+        i = child;
+    }
+
+    heap[i] = item;
+}
+
+// k наименьших номеров вхождений по возрастанию.
+// Поиск по первому наилучшему: minLeaf вершины не больше всего ее поддерева,
+// поэтому вершины из кучи выходят в порядке их наименьших листьев,
+// а листья - в порядке номеров. Раскрываются только вершины на пути
+// к k первым листьям, остальное поддерево не трогаем.
+long collectFirstMatches(SuffixTree tree, char *pattern, long m, long k, uint32_t **matches, long *matchCap) {
+    uint32_t node = locateS3(tree, pattern, m);
+    if (node == NO_NODE || k <= 0) return 0;
+
+    long total = subtreeLeavesS3(tree, node, NULL, NULL);
+
+    // без minLeaf (дерево дописывали) или если нужна заметная доля - сортируем все
+    if (!leavesIndexedS3(tree) || k * FIRST_FULL_SORT_RATIO >= total) {
+        long matchCount = collectMatches(tree, pattern, m, matches, matchCap);
+        return matchCount < k ? matchCount : k;
+    }
+
+    if (k > *matchCap) {
+        *matchCap = k;
+        *matches = realloc(*matches, sizeof(uint32_t) * k);
+    }
+
+    long heapCap = 64;
+    uint32_t *heap = malloc(sizeof(uint32_t) * heapCap);
+    long heapSize = 0;
+    long found = 0;
+
+    heap[heapSize++] = node;
+
+    while (found < k) {
+        uint32_t top = heap[0];
+        heap[0] = heap[--heapSize];
+        if (heapSize > 0) siftDownS3(tree, heap, heapSize);
+
+        if (tree->nodes[top].leafNum != NOT_LEAF) {
+            (*matches)[found++] = tree->nodes[top].leafNum;
+            continue;
+        }
+
+        for (uint32_t child = tree->nodes[top].firstChild; child != NO_NODE; child = tree->nodes[child].nextSibling) {
+            if (heapSize >= heapCap) {
+                heapCap *= 2;
+                heap = realloc(heap, sizeof(uint32_t) * heapCap);
+            }
+
+            heap[heapSize] = child;
+            siftUpS3(tree, heap, heapSize);
+            heapSize++;
+        }
+    }
+
+    free(heap);
+    return k;
+}
 
-    countingSort(matches, matchCount);
+void printMatches(long patternNum, uint32_t *matches, long matchCount) {
+    if (matchCount == 0) return;
 
     printf("%ld: ", patternNum);
     for (long i = 0; i < matchCount - 1; i++) {
         printf("%d, ", matches[i] + 1);
     }
     printf("%d\n", matches[matchCount - 1] + 1);
+}
+
+void printCount(long patternNum, long matchCount) {
+    if (matchCount == 0) return;
+
+    printf("%ld: %ld\n", patternNum, matchCount);
+}
 
+uint32_t* findMatches(long patternNum, SuffixTree tree, char *pattern, long m, uint32_t *matches, long *matchCap) {
+    long matchCount = collectMatches(tree, pattern, m, &matches, matchCap);
+    printMatches(patternNum, matches, matchCount);
     return matches;
-}
\ No newline at end of file
+}
+
+// ================ суффиксный массив ================
+//
+// Альтернатива дереву (ключ -a): SA строится SA-IS за O(n), LCP - Касаи.
+// Из LCP считаем Llcp/Rlcp для середин двоичного поиска (Манбер-Майерс),
+// тогда поиск паттерна занимает O(m + log n). Итого 12 байт на символ
+// против ~32-64 у дерева.
+
+#define EMPTY_SA UINT32_MAX
+
+void getBucketsSA(const uint32_t *s, long n, long K, long *buckets, bool end) {
+    for (long k = 0; k < K; k++) buckets[k] = 0;
+    for (long i = 0; i < n; i++) buckets[s[i]]++;
+
+    long sum = 0;
+    for (long k = 0; k < K; k++) {
+        sum += buckets[k];
+        buckets[k] = end ? sum : sum - buckets[k];
+    }
+}
+
+void induceSA(const uint32_t *s, uint32_t *SA, const bool *isS, long n, long K, long *buckets) {
+    getBucketsSA(s, n, K, buckets, false);
+    for (long i = 0; i < n; i++) {
+        if (SA[i] == EMPTY_SA || SA[i] == 0) continue;
+        long j = SA[i] - 1;
+        if (!isS[j]) SA[buckets[s[j]]++] = j;
+    }
+
+    getBucketsSA(s, n, K, buckets, true);
+    for (long i = n - 1; i >= 0; i--) {
+        if (SA[i] == EMPTY_SA || SA[i] == 0) continue;
+        long j = SA[i] - 1;
+        if (isS[j]) SA[--buckets[s[j]]] = j;
+    }
+}
+
+// s[n - 1] = 0 - единственный минимальный символ, остальные из [1, K)
+void sais(const uint32_t *s, uint32_t *SA, long n, long K) {
+    bool *isS = malloc(sizeof(bool) * n);
+    long *buckets = malloc(sizeof(long) * K);
+
+    isS[n - 1] = true;
+    for (long i = n - 2; i >= 0; i--) {
+        isS[i] = s[i] < s[i + 1] || (s[i] == s[i + 1] && isS[i + 1]);
+    }
+
+    #define IS_LMS(i) ((i) > 0 && isS[i] && !isS[(i) - 1])
+
+    // 1. сортируем LMS-подстроки индукцией от грубо расставленных LMS
+    getBucketsSA(s, n, K, buckets, true);
+    for (long i = 0; i < n; i++) SA[i] = EMPTY_SA;
+    for (long i = 1; i < n; i++) {
+        if (IS_LMS(i)) SA[--buckets[s[i]]] = i;
+    }
+    induceSA(s, SA, isS, n, K, buckets);
+
+    // 2. именуем LMS-подстроки, одинаковые получают одно имя
+    long n1 = 0;
+    for (long i = 0; i < n; i++) {
+        if (IS_LMS(SA[i])) SA[n1++] = SA[i];
+    }
+
+    for (long i = n1; i < n; i++) SA[i] = EMPTY_SA;
+
+    long name = 0;
+    long prev = -1;
+    for (long i = 0; i < n1; i++) {
+        long pos = SA[i];
+        bool diff = prev < 0;
+
+        for (long d = 0; !diff; d++) {
+            if (s[pos + d] != s[prev + d] || isS[pos + d] != isS[prev + d]) diff = true;
+            else if (d > 0 && (IS_LMS(pos + d) || IS_LMS(prev + d))) break;
+        }
+
+        if (diff) {
+            name++;
+            prev = pos;
+        }
+        SA[n1 + pos / 2] = name - 1;
+    }
+
+    for (long i = n - 1, j = n - 1; i >= n1; i--) {
+        if (SA[i] != EMPTY_SA) SA[j--] = SA[i];
+    }
+
+    // 3. сортируем LMS-суффиксы: рекурсивно, если имена повторяются
+    uint32_t *s1 = SA + n - n1;
+    if (name < n1) {
+        sais(s1, SA, n1, name);
+    } else {
+        for (long i = 0; i < n1; i++) SA[s1[i]] = i;
+    }
+
+    // 4. расставляем LMS-суффиксы по порядку и индуцируем остальные
+    for (long i = 1, j = 0; i < n; i++) {
+        if (IS_LMS(i)) s1[j++] = i;
+    }
+    for (long i = 0; i < n1; i++) SA[i] = s1[SA[i]];
+    for (long i = n1; i < n; i++) SA[i] = EMPTY_SA;
+
+    getBucketsSA(s, n, K, buckets, true);
+    for (long i = n1 - 1; i >= 0; i--) {
+        uint32_t j = SA[i];
+        SA[i] = EMPTY_SA;
+        SA[--buckets[s[j]]] = j;
+    }
+    induceSA(s, SA, isS, n, K, buckets);
+
+    #undef IS_LMS
+
+    free(isS);
+    free(buckets);
+}
+
+// заполняет Llcp/Rlcp для середин внутри (lo, hi), возвращает min LCP[lo + 1..hi].
+// Границы -1 и n - виртуальные суффиксы, lcp с ними 0
+uint32_t fillLcpLR(SuffixArray sa, const uint32_t *lcp, long lo, long hi) {
+    if (hi - lo == 1) return (lo < 0 || hi >= (long)sa->n) ? 0 : lcp[hi];
+
+    long mid = lo + (hi - lo) / 2;
+    uint32_t left = fillLcpLR(sa, lcp, lo, mid);
+    uint32_t right = fillLcpLR(sa, lcp, mid, hi);
+
+    sa->Llcp[mid] = left;
+    sa->Rlcp[mid] = right;
+
+    return left < right ? left : right;
+}
+
+SuffixArray buildSuffixArray(char *text, long n) {
+    // символы сдвигаем на 1, 0 - терминатор после текста
+    uint32_t *s = malloc(sizeof(uint32_t) * (n + 1));
+    for (long i = 0; i < n; i++) s[i] = (unsigned char)text[i] + 1;
+    s[n] = 0;
+
+    SuffixArray sa = buildSuffixArrayFrom(text, s, n, ALPHABET + 1);
+    free(s);
+
+    return sa;
+}
+
+// s - текст, переведенный в числа 1..K-1, s[n] = 0. Порядок чисел должен
+// совпадать с порядком символов text там, где паттерн может с ними сравниться
+SuffixArray buildSuffixArrayFrom(char *text, const uint32_t *s, long n, long K) {
+    SuffixArray sa = malloc(sizeof(_SuffixArray));
+    sa->text = text;
+    sa->n = n;
+    sa->map = NULL;
+    sa->mapSize = 0;
+
+    uint32_t *full = malloc(sizeof(uint32_t) * (n + 1));
+    sais(s, full, n + 1, K);
+
+    // full[0] - терминатор, он не нужен
+    sa->SA = malloc(sizeof(uint32_t) * n);
+    for (long i = 0; i < n; i++) sa->SA[i] = full[i + 1];
+
+    // Касаи: lcp[i] = lcp(SA[i - 1], SA[i]), rank переиспользует буфер full
+    uint32_t *rank = full;
+    uint32_t *lcp = malloc(sizeof(uint32_t) * n);
+    for (long i = 0; i < n; i++) rank[sa->SA[i]] = i;
+
+    long h = 0;
+    for (long i = 0; i < n; i++) {
+        if (rank[i] == 0) {
+            lcp[0] = 0;
+            h = 0;
+            continue;
+        }
+
+        long j = sa->SA[rank[i] - 1];
+        while (i + h < n && j + h < n && s[i + h] == s[j + h]) h++;
+        lcp[rank[i]] = h;
+        if (h > 0) h--;
+    }
+    free(full);
+
+    sa->Llcp = malloc(sizeof(uint32_t) * n);
+    sa->Rlcp = malloc(sizeof(uint32_t) * n);
+    fillLcpLR(sa, lcp, -1, n);
+    free(lcp);
+
+    return sa;
+}
+
+void deleteSuffixArray(SuffixArray sa) {
+    if (sa->map != NULL) {
+        munmap(sa->map, sa->mapSize);
+    } else {
+        free(sa->SA);
+        free(sa->Llcp);
+        free(sa->Rlcp);
+    }
+    free(sa);
+}
+
+// первый суффикс, который больше паттерна (upper) или не меньше его (!upper);
+// суффикс, начинающийся с паттерна, считается равным ему
+long searchBoundSA(SuffixArray sa, char *pattern, long m, bool upper) {
+    const unsigned char *text = (const unsigned char*)sa->text;
+    const unsigned char *p = (const unsigned char*)pattern;
+
+    long lo = -1;
+    long hi = sa->n;
+    // lcp паттерна с суффиксами на границах
+    long l = 0;
+    long r = 0;
+
+    while (hi - lo > 1) {
+        long mid = lo + (hi - lo) / 2;
+        bool goRight;
+
+        // паттерн совпадает с дальней границей дальше, чем середина с ней - ответ ясен без сравнения
+        if (l >= r && sa->Llcp[mid] > l) {
+            goRight = true;
+        } else if (l >= r && sa->Llcp[mid] < l) {
+            goRight = false;
+            r = sa->Llcp[mid];
+        } else if (r > l && sa->Rlcp[mid] > r) {
+            goRight = false;
+        } else if (r > l && sa->Rlcp[mid] < r) {
+            goRight = true;
+            l = sa->Rlcp[mid];
+        } else {
+            // середина совпадает с паттерном не меньше чем на max(l, r) - сравниваем дальше
+            long k = l > r ? l : r;
+            long suffix = sa->SA[mid];
+            while (k < m && suffix + k < sa->n && text[suffix + k] == p[k]) k++;
+
+            if (k == m) goRight = upper;
+            else goRight = suffix + k < sa->n && text[suffix + k] < p[k];
+
+            if (goRight) l = k;
+            else r = k;
+        }
+
+        if (goRight) lo = mid;
+        else hi = mid;
+    }
+
+    return hi;
+}
+
+// то же, что collectMatches, но по суффиксному массиву
+long collectMatchesSA(SuffixArray sa, char *pattern, long m, uint32_t **matches, long *matchCap) {
+    long from = searchBoundSA(sa, pattern, m, false);
+    long to = searchBoundSA(sa, pattern, m, true);
+    long matchCount = to - from;
+
+    if (matchCount <= 0) return 0;
+
+    if (matchCount > *matchCap) {
+        *matchCap = matchCount;
+        *matches = realloc(*matches, sizeof(uint32_t) * matchCount);
+    }
+
+    memcpy(*matches, sa->SA + from, sizeof(uint32_t) * matchCount);
+    sortPositions(*matches, matchCount);
+
+    return matchCount;
+}
+
+long countMatchesSA(SuffixArray sa, char *pattern, long m) {
+    long from = searchBoundSA(sa, pattern, m, false);
+    long to = searchBoundSA(sa, pattern, m, true);
+
+    return to > from ? to - from : 0;
+}
+
+// k наименьших номеров из отрезка SA: куча из k элементов с наибольшим наверху
+long collectFirstMatchesSA(SuffixArray sa, char *pattern, long m, long k, uint32_t **matches, long *matchCap) {
+    long from = searchBoundSA(sa, pattern, m, false);
+    long to = searchBoundSA(sa, pattern, m, true);
+    long total = to - from;
+
+    if (total <= 0 || k <= 0) return 0;
+    if (k >= total) return collectMatchesSA(sa, pattern, m, matches, matchCap);
+
+    if (k > *matchCap) {
+        *matchCap = k;
+        *matches = realloc(*matches, sizeof(uint32_t) * k);
+    }
+
+    uint32_t *heap = *matches;
+
+    for (long i = 0; i < total; i++) {
+        uint32_t pos = sa->SA[from + i];
+        long j;
+
+        if (i < k) {
+            j = i;
+            while (j > 0 && heap[(j - 1) / 2] < pos) {
+                heap[j] = heap[(j - 1) / 2];
+                j = (j - 1) / 2;
+            }
+        } else {
+            if (pos >= heap[0]) continue;
+
+            j = 0;
+            while (2 * j + 1 < k) {
+                long child = 2 * j + 1;
+                if (child + 1 < k && heap[child + 1] > heap[child]) child++;
+                if (heap[child] <= pos) break;
+
+                heap[j] = heap[child];
+                j = child;
+            }
+        }
+
+        heap[j] = pos;
+    }
+
+    sortPositions(heap, k);
+    return k;
+}
+
+uint32_t* findMatchesSA(long patternNum, SuffixArray sa, char *pattern, long m, uint32_t *matches, long *matchCap) {
+    long matchCount = collectMatchesSA(sa, pattern, m, &matches, matchCap);
+    printMatches(patternNum, matches, matchCount);
+    return matches;
+}
+
+// ================ поиск по набору документов ================
+//
+// Документы склеиваются через разделители, и по склейке строится один
+// суффиксный массив. Каждому разделителю дается свой символ - иначе
+// одинаковые хвосты разных документов сравнивались бы и дальше разделителя.
+// Все разделители стоят в алфавите там же, где '\n', поэтому поиск
+// по тексту с '\n' идет в том же порядке, что и SA.
+//
+// Документы без повторов выдает алгоритм Мутукришнана: в отрезке SA
+// документ i-го суффикса встречается впервые, если prevSame[i] не попадает
+// в отрезок. Такой i ищется минимумом prevSame, дальше отрезок делится
+// на две части. На каждый выданный документ - один запрос минимума.
+
+#define RMQ_BLOCK 32
+
+// документы - строки stdin до пустой строки; в тексте каждая заканчивается '\n'
+char* readDocuments(long *length, uint32_t *docCount) {
+    char *buffer = NULL;
+    long size = 0;
+    long cap = 0;
+    uint32_t count = 0;
+
+    while (1) {
+        long start = size;
+        buffer = readPattern(buffer, &size, &cap);
+        if (size == start) break;
+
+        buffer[size++] = '\n';
+        count++;
+
+        if (feof(stdin)) break;
+    }
+
+    *length = size;
+    *docCount = count;
+    return buffer;
+}
+
+// номер позиции из [l, r) с наименьшим prevSame
+long argminDocuments(DocumentIndex index, long l, long r) {
+    const uint32_t *prevSame = index->prevSame;
+    long best = l;
+
+    long firstBlock = l / RMQ_BLOCK + 1;
+    long lastBlock = r / RMQ_BLOCK;
+
+    // куски крайних блоков просматриваем, середину берем из таблицы
+    if (firstBlock >= lastBlock) {
+        for (long i = l + 1; i < r; i++) {
+            if (prevSame[i] < prevSame[best]) best = i;
+        }
+        return best;
+    }
+
+    for (long i = l + 1; i < firstBlock * RMQ_BLOCK; i++) {
+        if (prevSame[i] < prevSame[best]) best = i;
+    }
+    for (long i = lastBlock * RMQ_BLOCK; i < r; i++) {
+        if (prevSame[i] < prevSame[best]) best = i;
+    }
+
+    int level = 63 - __builtin_clzl(lastBlock - firstBlock);
+    const uint32_t *row = index->blockMin + (size_t)level * index->blockCount;
+
+    uint32_t left = row[firstBlock];
+    uint32_t right = row[lastBlock - (1L << level)];
+    if (prevSame[left] < prevSame[best]) best = left;
+    if (prevSame[right] < prevSame[best]) best = right;
+
+    return best;
+}
+
+DocumentIndex buildDocumentIndex(char *text, long n, uint32_t docCount) {
+    DocumentIndex index = malloc(sizeof(_DocumentIndex));
+    index->text = text;
+    index->docCount = docCount;
+
+    // символы меньше '\n' -> 1..'\n', разделители -> '\n' + 1.., остальные - после них
+    uint32_t *s = malloc(sizeof(uint32_t) * (n + 1));
+    uint32_t *docAt = malloc(sizeof(uint32_t) * (n > 0 ? n : 1));
+    uint32_t doc = 0;
+
+    for (long i = 0; i < n; i++) {
+        unsigned char c = text[i];
+        docAt[i] = doc;
+
+        if (c == '\n') s[i] = '\n' + 1 + doc++;
+        else if (c < '\n') s[i] = c + 1;
+        else s[i] = c + docCount;
+    }
+    s[n] = 0;
+
+    index->sa = buildSuffixArrayFrom(text, s, n, ALPHABET + docCount);
+    free(s);
+
+    const uint32_t *SA = index->sa->SA;
+    index->docOf = malloc(sizeof(uint32_t) * (n > 0 ? n : 1));
+    index->prevSame = malloc(sizeof(uint32_t) * (n > 0 ? n : 1));
+    index->counts = calloc(docCount > 0 ? docCount : 1, sizeof(uint32_t));
+
+    for (long i = 0; i < n; i++) index->docOf[i] = docAt[SA[i]];
+
+    // docAt больше не нужен - в нем же запоминаем последнее место документа в SA
+    uint32_t *last = docAt;
+    for (uint32_t d = 0; d < docCount; d++) last[d] = 0;
+
+    for (long i = 0; i < n; i++) {
+        uint32_t d = index->docOf[i];
+        index->prevSame[i] = last[d];
+        last[d] = i + 1;
+    }
+    free(docAt);
+
+    // blockMin[k][b] - argmin по блокам [b, b + 2^k)
+    index->blockCount = (n + RMQ_BLOCK - 1) / RMQ_BLOCK;
+    index->levels = 1;
+    while ((1L << index->levels) <= index->blockCount) index->levels++;
+
+    index->blockMin = malloc(sizeof(uint32_t) * index->levels * (index->blockCount > 0 ? index->blockCount : 1));
+    uint32_t *row = index->blockMin;
+
+    for (long b = 0; b < index->blockCount; b++) {
+        long best = b * RMQ_BLOCK;
+        for (long i = best + 1; i < n && i < (b + 1) * RMQ_BLOCK; i++) {
+            if (index->prevSame[i] < index->prevSame[best]) best = i;
+        }
+        row[b] = best;
+    }
+
+    for (int k = 1; k < index->levels; k++) {
+        uint32_t *prev = index->blockMin + (size_t)(k - 1) * index->blockCount;
+        row = index->blockMin + (size_t)k * index->blockCount;
+
+        for (long b = 0; b + (1L << k) <= index->blockCount; b++) {
+            uint32_t left = prev[b];
+            uint32_t right = prev[b + (1L << (k - 1))];
+            row[b] = index->prevSame[right] < index->prevSame[left] ? right : left;
+        }
+    }
+
+    return index;
+}
+
+void deleteDocumentIndex(DocumentIndex index) {
+    deleteSuffixArray(index->sa);
+    free(index->docOf);
+    free(index->prevSame);
+    free(index->blockMin);
+    free(index->counts);
+    free(index);
+}
+
+// номера документов, где есть паттерн, по возрастанию; O(m log n + число документов)
+long listDocuments(DocumentIndex index, char *pattern, long m, uint32_t **docs, long *docCap) {
+    long from = searchBoundSA(index->sa, pattern, m, false);
+    long to = searchBoundSA(index->sa, pattern, m, true);
+    if (to <= from) return 0;
+
+    long docCount = 0;
+
+    // отрезки [l, r), которые осталось разобрать; каждый выданный документ добавляет не больше двух
+    long stackCap = 64;
+    long *stack = malloc(sizeof(long) * 2 * stackCap);
+    long depth = 0;
+
+    stack[0] = from;
+    stack[1] = to;
+    depth = 1;
+
+    while (depth > 0) {
+        depth--;
+        long l = stack[2 * depth];
+        long r = stack[2 * depth + 1];
+
+        long i = argminDocuments(index, l, r);
+        // документ уже встречался левее - в этом отрезке новых нет
+        if (index->prevSame[i] > (uint32_t)from) continue;
+
+        if (docCount >= *docCap) {
+            *docCap = *docCap * 2 + 16;
+            *docs = realloc(*docs, sizeof(uint32_t) * *docCap);
+        }
+        (*docs)[docCount++] = index->docOf[i];
+
+        if (depth + 2 > stackCap) {
+            stackCap *= 2;
+            stack = realloc(stack, sizeof(long) * 2 * stackCap);
+        }
+
+        if (l < i) {
+            stack[2 * depth] = l;
+            stack[2 * depth + 1] = i;
+            depth++;
+        }
+        if (i + 1 < r) {
+            stack[2 * depth] = i + 1;
+            stack[2 * depth + 1] = r;
+            depth++;
+        }
+    }
+
+    free(stack);
+    sortPositions(*docs, docCount);
+
+    return docCount;
+}
+
+// то же, что listDocuments, и число вхождений в каждый документ; O(m log n + число вхождений)
+long countDocuments(DocumentIndex index, char *pattern, long m, uint32_t **docs, uint32_t **docCounts, long *docCap) {
+    long from = searchBoundSA(index->sa, pattern, m, false);
+    long to = searchBoundSA(index->sa, pattern, m, true);
+    long docCount = 0;
+
+    for (long i = from; i < to; i++) {
+        uint32_t doc = index->docOf[i];
+        if (index->counts[doc]++ > 0) continue;
+
+        if (docCount >= *docCap) {
+            *docCap = *docCap * 2 + 16;
+            *docs = realloc(*docs, sizeof(uint32_t) * *docCap);
+            *docCounts = realloc(*docCounts, sizeof(uint32_t) * *docCap);
+        }
+        (*docs)[docCount++] = doc;
+    }
+
+    sortPositions(*docs, docCount);
+
+    for (long i = 0; i < docCount; i++) {
+        (*docCounts)[i] = index->counts[(*docs)[i]];
+        index->counts[(*docs)[i]] = 0;
+    }
+
+    return docCount;
+}
+
+// ./app.out -d: документы до пустой строки, дальше паттерны.
+// Вывод - "номер паттерна: документы", с -c - "документ (число вхождений)"
+int queryDocuments(QueryMode mode) {
+    long n;
+    uint32_t docCount;
+    char *text = readDocuments(&n, &docCount);
+
+    if (n >= UINT32_MAX || (uint64_t)docCount + ALPHABET >= UINT32_MAX) {
+        fprintf(stderr, "documents are too long\n");
+        free(text);
+        return 1;
+    }
+
+    DocumentIndex index = buildDocumentIndex(text, n, docCount);
+
+    long cap = 0;
+    long m = 0;
+    char *pattern = NULL;
+    long patternNum = 0;
+
+    long docCap = 0;
+    uint32_t *docs = NULL;
+    uint32_t *docCounts = NULL;
+
+    while (1) {
+        m = 0;
+        pattern = readPattern(pattern, &m, &cap);
+        if (feof(stdin) || m == 0) break;
+        patternNum++;
+
+        long found = mode.kind == QUERY_COUNT
+            ? countDocuments(index, pattern, m, &docs, &docCounts, &docCap)
+            : listDocuments(index, pattern, m, &docs, &docCap);
+        if (found == 0) continue;
+
+        printf("%ld: ", patternNum);
+        for (long i = 0; i < found; i++) {
+            if (i > 0) printf(", ");
+            if (mode.kind == QUERY_COUNT) printf("%u (%u)", docs[i] + 1, docCounts[i]);
+            else printf("%u", docs[i] + 1);
+        }
+        printf("\n");
+    }
+
+    free(docs);
+    free(docCounts);
+    free(pattern);
+    deleteDocumentIndex(index);
+    free(text);
+
+    return 0;
+}
+
+// ================ дописывание текста ================
+
+// ./app.out -o: ">кусок" дописывает кусок (без перевода строки) к тексту, остальные
+// строки - паттерны. Дерево не перестраивается: Укконен продолжает с того же места
+int queryOnline(QueryMode mode) {
+    SuffixTree tree = createSuffixTree();
+
+    long cap = 0;
+    long m = 0;
+    char *line = NULL;
+    long patternNum = 0;
+
+    long matchCap = 0;
+    uint32_t *matches = NULL;
+
+    while (1) {
+        m = 0;
+        line = readPattern(line, &m, &cap);
+        if (feof(stdin) || m == 0) break;
+
+        if (line[0] == '>') {
+            if (!appendSuffixTree(tree, line + 1, m - 1)) {
+                fprintf(stderr, "text is too long\n");
+                break;
+            }
+            continue;
+        }
+
+        patternNum++;
+
+        long matchCount = answerQuery(tree, NULL, mode, line, m, &matches, &matchCap);
+        if (mode.kind == QUERY_COUNT) printCount(patternNum, matchCount);
+        else printMatches(patternNum, matches, matchCount);
+    }
+
+    free(matches);
+    free(line);
+    deleteSuffixTree(tree);
+
+    return 0;
+}
+
+// ================ повторы ================
+//
+// Строковая глубина внутренней вершины - длина подстроки, которая встречается
+// столько раз, сколько листьев в поддереве (вершина ветвится, значит, хотя бы
+// дважды). Повтор максимальный, если его нельзя продлить ни вправо (это и есть
+// ветвление), ни влево - перед вхождениями стоят разные байты. Для двух текстов
+// дерево строится по склейке "первый, разделитель, второй": разделитель
+// встречается один раз, поэтому во внутренние вершины не попадает, а общая
+// подстрока - вершина с листьями из обоих текстов. Все считается за один обход.
+
+void mergeRepeatS3(RepeatInfo *into, const RepeatInfo *from) {
+    if (from->firstA < into->firstA) into->firstA = from->firstA;
+    if (from->firstB < into->firstB) into->firstB = from->firstB;
+    into->count += from->count;
+
+    if (into->left == LEFT_NONE) into->left = from->left;
+    else if (into->left != from->left) into->left = LEFT_DIVERSE;
+}
+
+// split - начало второго текста в склейке; tree->end, если текст один.
+// Обход снизу вверх с явным стеком: на повторяющемся тексте глубина дерева - O(n)
+Repeats findRepeatsS3(SuffixTree tree, Pos split, long minLength) {
+    S3_Node *nodes = tree->nodes;
+    const char *text = tree->text;
+    bool twoTexts = split < tree->end;
+
+    RepeatInfo empty = {0, NOT_LEAF, NOT_LEAF, 0, LEFT_NONE};
+    Repeats res = {empty, NULL, 0, 0};
+
+    struct Frame {
+        RepeatInfo info;
+        // следующий ребенок, в которого спускаться
+        uint32_t child;
+    } *stack = malloc(sizeof(struct Frame) * POOL_START_CAP);
+    long stackCap = POOL_START_CAP;
+    long depth = 0;
+
+    stack[depth].info = empty;
+    stack[depth].child = nodes[ROOT].firstChild;
+    depth++;
+
+    while (depth > 0) {
+        struct Frame *top = &stack[depth - 1];
+
+        if (top->child == NO_NODE) {
+            depth--;
+            if (depth == 0) break;
+
+            RepeatInfo *info = &top->info;
+            bool common = !twoTexts || (info->firstA != NOT_LEAF && info->firstB != NOT_LEAF);
+
+            if (common && info->depth > res.longest.depth) res.longest = *info;
+
+            if (common && info->left == LEFT_DIVERSE && info->depth >= minLength) {
+                if (res.maximalCount >= res.maximalCap) {
+                    res.maximalCap = res.maximalCap > 0 ? res.maximalCap * 2 : EXTEND_SIZE;
+                    res.maximal = realloc(res.maximal, sizeof(RepeatInfo) * res.maximalCap);
+                }
+                res.maximal[res.maximalCount++] = *info;
+            }
+
+            mergeRepeatS3(&stack[depth - 1].info, info);
+            continue;
+        }
+
+        uint32_t child = top->child;
+        top->child = nodes[child].nextSibling;
+
+        if (nodes[child].leafNum != NOT_LEAF) {
+            Pos pos = nodes[child].leafNum;
+            RepeatInfo leaf = {0, NOT_LEAF, NOT_LEAF, 1, LEFT_DIVERSE};
+
+            if (pos < split) leaf.firstA = pos;
+            else leaf.firstB = pos - split;
+            if (pos != 0 && pos != split) leaf.left = (unsigned char)text[pos - 1];
+
+            mergeRepeatS3(&top->info, &leaf);
+            continue;
+        }
+
+        long childDepth = top->info.depth + nodes[child].end - nodes[child].start;
+
+        if (depth >= stackCap) {
+            stackCap *= 2;
+            stack = realloc(stack, sizeof(struct Frame) * stackCap);
+        }
+
+        stack[depth].info = empty;
+        stack[depth].info.depth = childDepth;
+        stack[depth].child = nodes[child].firstChild;
+        depth++;
+    }
+
+    free(stack);
+    return res;
+}
+
+// длинные повторы первыми, равные - по первому вхождению
+int cmpRepeats(const void *a, const void *b) {
+    const RepeatInfo *x = a;
+    const RepeatInfo *y = b;
+
+    if (x->depth != y->depth) return x->depth < y->depth ? 1 : -1;
+    if (x->firstA != y->firstA) return x->firstA < y->firstA ? -1 : 1;
+    return (x->firstB > y->firstB) - (x->firstB < y->firstB);
+}
+
+// "длина at позиция, число times" или для двух текстов "длина at позиция and позиция"
+void printRepeat(const RepeatInfo *info, bool twoTexts) {
+    if (twoTexts) printf("%ld at %u and %u\n", info->depth, info->firstA + 1, info->firstB + 1);
+    else printf("%ld at %u, %ld times\n", info->depth, info->firstA + 1, info->count);
+}
+
+// ./app.out -r L: текст в первой строке, второй текст (если есть) - во второй.
+// Печатает "longest ..." - самый длинный повтор или общую подстроку, "maximal N" и
+// N максимальных повторов длиной от L (с двумя текстами - встречающихся в обоих).
+// Позиции с 1, во втором тексте - от его начала
+int queryRepeats(long minLength) {
+    long n;
+    char *first = readText(&n);
+    long m;
+    char *second = readText(&m);
+
+    bool twoTexts = m > 1;
+    char *text = first;
+    long length = n;
+
+    if (twoTexts) {
+        // разделитель - байт, которого нет ни в одном тексте
+        bool used[ALPHABET] = {false};
+        used['\n'] = true;
+        for (long i = 0; i < n; i++) used[(unsigned char)first[i]] = true;
+        for (long i = 0; i < m; i++) used[(unsigned char)second[i]] = true;
+
+        int separator = 0;
+        while (separator < ALPHABET && used[separator]) separator++;
+
+        if (separator == ALPHABET) {
+            fprintf(stderr, "texts use every byte, no separator left\n");
+            free(first);
+            free(second);
+            return 1;
+        }
+
+        length = n + m;
+        text = malloc(length);
+        memcpy(text, first, n - 1);
+        text[n - 1] = separator;
+        memcpy(text + n, second, m);
+    }
+
+    if (length >= UINT32_MAX) {
+        fprintf(stderr, "text is too long\n");
+        if (text != first) free(text);
+        free(first);
+        free(second);
+        return 1;
+    }
+
+    SuffixTree tree = buildSuffixTree(text, length);
+    Repeats repeats = findRepeatsS3(tree, twoTexts ? n : length, minLength);
+
+    if (repeats.longest.depth == 0) {
+        printf("longest 0\n");
+    } else {
+        printf("longest ");
+        printRepeat(&repeats.longest, twoTexts);
+    }
+
+    if (repeats.maximalCount > 0) qsort(repeats.maximal, repeats.maximalCount, sizeof(RepeatInfo), cmpRepeats);
+
+    printf("maximal %ld\n", repeats.maximalCount);
+    for (long i = 0; i < repeats.maximalCount; i++) printRepeat(&repeats.maximal[i], twoTexts);
+
+    free(repeats.maximal);
+    deleteSuffixTree(tree);
+    if (text != first) free(text);
+    free(first);
+    free(second);
+
+    return 0;
+}
+
+// ================ сохранение индекса ================
+//
+// Дерево и массив уже лежат плоскими массивами со ссылками-номерами,
+// поэтому файл - это заголовок и те же массивы подряд (каждый выровнен на 8).
+// Загрузка отображает файл только на чтение и ставит указатели внутрь:
+// O(1), страницы подтягиваются при первом обращении.
+// Содержимое секций не проверяется - файл должен быть создан этой программой.
+//
+//   дерево: текст, вершины, таблицы детей, листья по порядку обхода, leafLo, leafHi, minLeaf
+//   массив: текст, SA, Llcp, Rlcp
+
+bool writeIndex(const char *path, IndexHeader *header, const void **sections) {
+    memcpy(header->magic, INDEX_MAGIC, sizeof(header->magic));
+
+    uint64_t offset = sizeof(IndexHeader);
+    for (int i = 0; i < INDEX_SECTIONS; i++) {
+        offset = (offset + 7) / 8 * 8;
+        header->offsets[i] = offset;
+        offset += header->sizes[i];
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) return false;
+
+    bool ok = fwrite(header, sizeof(IndexHeader), 1, file) == 1;
+    uint64_t written = sizeof(IndexHeader);
+    char zeros[8] = {0};
+
+    for (int i = 0; ok && i < INDEX_SECTIONS; i++) {
+        ok = fwrite(zeros, 1, header->offsets[i] - written, file) == header->offsets[i] - written;
+        // пустые секции (лишние для вида индекса, таблиц нет) бывают NULL
+        if (header->sizes[i] > 0) ok = ok && fwrite(sections[i], 1, header->sizes[i], file) == header->sizes[i];
+        written = header->offsets[i] + header->sizes[i];
+    }
+
+    ok = fclose(file) == 0 && ok;
+    return ok;
+}
+
+bool saveSuffixTree(SuffixTree tree, const char *path) {
+    if (!leavesIndexedS3(tree)) indexLeavesS3(tree);
+
+    IndexHeader header;
+    memset(&header, 0, sizeof(header));
+
+    header.kind = INDEX_TREE;
+    header.n = tree->end;
+    header.nodeCount = tree->size;
+    header.tableCount = tree->tableCount;
+    header.leafCount = tree->leafCount;
+    header.sigma = tree->sigma;
+    header.tableShift = tree->tableShift;
+    header.remainder = tree->remainder;
+    memcpy(header.rank, tree->rank, sizeof(header.rank));
+    header.sizes[0] = tree->end;
+    header.sizes[1] = sizeof(S3_Node) * (uint64_t)tree->size;
+    header.sizes[2] = (sizeof(uint32_t) << tree->tableShift) * (uint64_t)tree->tableCount;
+    header.sizes[3] = sizeof(uint32_t) * (uint64_t)tree->leafCount;
+    header.sizes[4] = sizeof(uint32_t) * (uint64_t)tree->size;
+    header.sizes[5] = header.sizes[4];
+    header.sizes[6] = header.sizes[4];
+
+    const void *sections[INDEX_SECTIONS] = {tree->text, tree->nodes, tree->tables,
+        tree->leaves, tree->leafLo, tree->leafHi, tree->minLeaf};
+    return writeIndex(path, &header, sections);
+}
+
+bool saveSuffixArray(SuffixArray sa, const char *path) {
+    IndexHeader header;
+    memset(&header, 0, sizeof(header));
+
+    header.kind = INDEX_ARRAY;
+    header.n = sa->n;
+    header.sizes[0] = sa->n;
+    header.sizes[1] = sizeof(uint32_t) * (uint64_t)sa->n;
+    header.sizes[2] = header.sizes[1];
+    header.sizes[3] = header.sizes[1];
+
+    const void *sections[INDEX_SECTIONS] = {sa->text, sa->SA, sa->Llcp, sa->Rlcp, NULL, NULL, NULL};
+    return writeIndex(path, &header, sections);
+}
+
+// NULL, если файла нет или это не индекс
+const IndexHeader* mapIndex(const char *path, size_t *mapSize) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(IndexHeader)) {
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+
+    if (map == MAP_FAILED) return NULL;
+
+    const IndexHeader *header = map;
+    uint64_t size = st.st_size;
+
+    // размеры секций должны соответствовать виду индекса
+    uint64_t cell = sizeof(uint32_t) * (uint64_t)header->n;
+    bool valid = memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) == 0 && header->n > 0
+        && header->sizes[0] == header->n;
+
+    if (valid && header->kind == INDEX_TREE) {
+        valid = header->nodeCount > 0
+            && header->sizes[1] == sizeof(S3_Node) * (uint64_t)header->nodeCount
+            && header->sigma <= ALPHABET && header->tableShift <= 9 && header->remainder <= header->n
+            && header->sizes[2] == (sizeof(uint32_t) << header->tableShift) * (uint64_t)header->tableCount
+            && header->leafCount <= header->n
+            && header->sizes[3] == sizeof(uint32_t) * (uint64_t)header->leafCount
+            && header->sizes[4] == sizeof(uint32_t) * (uint64_t)header->nodeCount
+            && header->sizes[5] == header->sizes[4]
+            && header->sizes[6] == header->sizes[4];
+    } else if (valid && header->kind == INDEX_ARRAY) {
+        valid = header->sizes[1] == cell && header->sizes[2] == cell && header->sizes[3] == cell
+            && header->sizes[4] == 0 && header->sizes[5] == 0 && header->sizes[6] == 0;
+    } else {
+        valid = false;
+    }
+
+    for (int i = 0; valid && i < INDEX_SECTIONS; i++) {
+        valid = header->offsets[i] % 8 == 0 && header->offsets[i] >= sizeof(IndexHeader)
+            && header->offsets[i] <= size && header->sizes[i] <= size - header->offsets[i];
+    }
+
+    if (!valid) {
+        munmap(map, st.st_size);
+        return NULL;
+    }
+
+    // запросы обращаются к индексу вразнобой
+    madvise(map, st.st_size, MADV_RANDOM);
+
+    *mapSize = st.st_size;
+    return header;
+}
+
+SuffixTree loadSuffixTree(const IndexHeader *header, size_t mapSize) {
+    const char *base = (const char*)header;
+    SuffixTree tree = malloc(sizeof(_SuffixTree));
+
+    tree->text = (char*)(base + header->offsets[0]);
+    tree->end = header->n;
+    tree->nodes = (S3_Node*)(base + header->offsets[1]);
+    tree->size = header->nodeCount;
+    tree->cap = header->nodeCount;
+    tree->tables = (uint32_t*)(base + header->offsets[2]);
+    tree->tableCount = header->tableCount;
+    tree->tableCap = header->tableCount;
+    memcpy(tree->rank, header->rank, sizeof(tree->rank));
+    tree->sigma = header->sigma;
+    tree->tableShift = header->tableShift;
+    tree->remainder = header->remainder;
+    tree->textCap = 0;
+    tree->indexedEnd = header->n;
+    tree->leaves = (uint32_t*)(base + header->offsets[3]);
+    tree->leafLo = (uint32_t*)(base + header->offsets[4]);
+    tree->leafHi = (uint32_t*)(base + header->offsets[5]);
+    tree->minLeaf = (uint32_t*)(base + header->offsets[6]);
+    tree->leafCount = header->leafCount;
+    tree->map = (void*)header;
+    tree->mapSize = mapSize;
+
+    return tree;
+}
+
+SuffixArray loadSuffixArray(const IndexHeader *header, size_t mapSize) {
+    const char *base = (const char*)header;
+    SuffixArray sa = malloc(sizeof(_SuffixArray));
+
+    sa->text = (char*)(base + header->offsets[0]);
+    sa->n = header->n;
+    sa->SA = (uint32_t*)(base + header->offsets[1]);
+    sa->Llcp = (uint32_t*)(base + header->offsets[2]);
+    sa->Rlcp = (uint32_t*)(base + header->offsets[3]);
+    sa->map = (void*)header;
+    sa->mapSize = mapSize;
+
+    return sa;
+}
+
+// ================ пакетные запросы в несколько потоков ================
+//
+// Индекс во время поиска только читается, поэтому паттерны можно раздать
+// потокам. Паттерны читаются заранее и обрабатываются окнами по QUERY_WINDOW:
+// потоки создаются один раз на пакет, берут блоки по QUERY_BLOCK паттернов,
+// пишут ответы в свои буферы, затем окно печатается в порядке входа.
+
+#define QUERY_WINDOW (1 << 14)
+#define QUERY_BLOCK 16
+
+typedef struct Patterns {
+    char *data;
+    long *starts;
+    long *lengths;
+    long count;
+} Patterns;
+
+// все паттерны stdin в одном буфере, каждый заканчивается '\0'
+Patterns readAllPatterns() {
+    Patterns res = {NULL, NULL, NULL, 0};
+    long size = 0;
+    long cap = 0;
+    long listCap = 0;
+
+    while (1) {
+        long start = size;
+        res.data = readPattern(res.data, &size, &cap);
+        if (feof(stdin) || size == start) break;
+
+        if (res.count >= listCap) {
+            listCap = listCap * 2 + 16;
+            res.starts = realloc(res.starts, sizeof(long) * listCap);
+            res.lengths = realloc(res.lengths, sizeof(long) * listCap);
+        }
+
+        res.starts[res.count] = start;
+        res.lengths[res.count] = size - start;
+        res.count++;
+
+        // следующий паттерн - после '\0'
+        size++;
+    }
+
+    return res;
+}
+
+void deletePatterns(Patterns *patterns) {
+    free(patterns->data);
+    free(patterns->starts);
+    free(patterns->lengths);
+}
+
+typedef struct OutBuffer {
+    char *data;
+    size_t size;
+    size_t cap;
+} OutBuffer;
+
+void appendNumber(OutBuffer *out, unsigned long value) {
+    char digits[24];
+    int len = 0;
+
+    do {
+        digits[len++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+
+    while (len > 0) out->data[out->size++] = digits[--len];
+}
+
+// то же, что printCount, но в буфер
+void appendCount(OutBuffer *out, long patternNum, long matchCount) {
+    if (matchCount == 0) return;
+
+    if (out->size + 48 > out->cap) {
+        out->cap = (out->size + 48) * 2;
+        out->data = realloc(out->data, out->cap);
+    }
+
+    appendNumber(out, patternNum);
+    out->data[out->size++] = ':';
+    out->data[out->size++] = ' ';
+    appendNumber(out, matchCount);
+    out->data[out->size++] = '\n';
+}
+
+// то же, что printMatches, но в буфер
+void appendMatches(OutBuffer *out, long patternNum, uint32_t *matches, long matchCount) {
+    if (matchCount == 0) return;
+
+    // на число не больше 20 цифр и ", "
+    size_t need = out->size + 24 * (size_t)(matchCount + 1);
+    if (need > out->cap) {
+        out->cap = need * 2;
+        out->data = realloc(out->data, out->cap);
+    }
+
+    appendNumber(out, patternNum);
+    out->data[out->size++] = ':';
+
+    for (long i = 0; i < matchCount; i++) {
+        out->data[out->size++] = i == 0 ? ' ' : ',';
+        if (i > 0) out->data[out->size++] = ' ';
+        appendNumber(out, matches[i] + 1UL);
+    }
+
+    out->data[out->size++] = '\n';
+}
+
+// число вхождений для QUERY_COUNT, иначе - сколько номеров записано в *matches
+long answerQuery(SuffixTree tree, SuffixArray sa, QueryMode mode, char *pattern, long m, uint32_t **matches, long *matchCap) {
+    switch (mode.kind) {
+        case QUERY_COUNT:
+            return sa != NULL ? countMatchesSA(sa, pattern, m) : countMatches(tree, pattern, m);
+        case QUERY_FIRST:
+            return sa != NULL
+                ? collectFirstMatchesSA(sa, pattern, m, mode.k, matches, matchCap)
+                : collectFirstMatches(tree, pattern, m, mode.k, matches, matchCap);
+        default:
+            return sa != NULL
+                ? collectMatchesSA(sa, pattern, m, matches, matchCap)
+                : collectMatches(tree, pattern, m, matches, matchCap);
+    }
+}
+
+typedef struct QueryPool {
+    SuffixTree tree;
+    SuffixArray sa;
+    QueryMode mode;
+    Patterns *patterns;
+
+    // текущее окно [from, to) и следующий свободный паттерн в нем
+    long from;
+    long to;
+    long next;
+    pthread_mutex_t lock;
+
+    // потоки живут весь пакет: ждут нового окна (window растет на 1),
+    // разбирают его и отчитываются через pending
+    long window;
+    int pending;
+    bool stop;
+    pthread_cond_t windowReady;
+    pthread_cond_t windowDone;
+
+    // ответ паттерна from + i лежит в буфере потока owners[i]
+    int *owners;
+    size_t *offsets;
+    size_t *lengths;
+} QueryPool;
+
+typedef struct QueryWorker {
+    QueryPool *pool;
+    int id;
+    OutBuffer out;
+    uint32_t *matches;
+    long matchCap;
+} QueryWorker;
+
+// берет блоки паттернов текущего окна, пока они не кончатся
+void answerBlocks(QueryWorker *worker) {
+    QueryPool *pool = worker->pool;
+    Patterns *patterns = pool->patterns;
+
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        long first = pool->next;
+        pool->next = first + QUERY_BLOCK < pool->to ? first + QUERY_BLOCK : pool->to;
+        long last = pool->next;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (first >= last) break;
+
+        for (long i = first; i < last; i++) {
+            char *pattern = patterns->data + patterns->starts[i];
+            long m = patterns->lengths[i];
+
+            long matchCount = answerQuery(pool->tree, pool->sa, pool->mode, pattern, m,
+                &worker->matches, &worker->matchCap);
+
+            size_t offset = worker->out.size;
+            if (pool->mode.kind == QUERY_COUNT) appendCount(&worker->out, i + 1, matchCount);
+            else appendMatches(&worker->out, i + 1, worker->matches, matchCount);
+
+            pool->owners[i - pool->from] = worker->id;
+            pool->offsets[i - pool->from] = offset;
+            pool->lengths[i - pool->from] = worker->out.size - offset;
+        }
+    }
+}
+
+void *queryWorkerRun(void *arg) {
+    QueryWorker *worker = arg;
+    QueryPool *pool = worker->pool;
+    long seen = 0;
+
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->stop && pool->window == seen) pthread_cond_wait(&pool->windowReady, &pool->lock);
+        bool stop = pool->stop;
+        seen = pool->window;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (stop) break;
+
+        answerBlocks(worker);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) pthread_cond_signal(&pool->windowDone);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    return NULL;
+}
+
+// отвечает на все паттерны stdin; индекс - либо tree, либо sa. threads <= 0 - по числу ядер
+void batchQueries(SuffixTree tree, SuffixArray sa, QueryMode mode, int threads) {
+    if (threads <= 0) threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads <= 0) threads = 1;
+
+    Patterns patterns = readAllPatterns();
+
+    QueryPool pool;
+    pool.tree = tree;
+    pool.sa = sa;
+    pool.mode = mode;
+    pool.patterns = &patterns;
+    pool.from = 0;
+    pool.to = 0;
+    pool.next = 0;
+    pool.window = 0;
+    pool.pending = 0;
+    pool.stop = false;
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.windowReady, NULL);
+    pthread_cond_init(&pool.windowDone, NULL);
+    pool.owners = malloc(sizeof(int) * QUERY_WINDOW);
+    pool.offsets = malloc(sizeof(size_t) * QUERY_WINDOW);
+    pool.lengths = malloc(sizeof(size_t) * QUERY_WINDOW);
+
+    QueryWorker *workers = malloc(sizeof(QueryWorker) * threads);
+    pthread_t *ids = malloc(sizeof(pthread_t) * threads);
+    bool *started = malloc(sizeof(bool) * threads);
+
+    for (int t = 0; t < threads; t++) {
+        QueryWorker worker = {&pool, t, {NULL, 0, 0}, NULL, 0};
+        workers[t] = worker;
+    }
+
+    // нулевой поток - вызывающий; не создавшиеся потоки просто не участвуют
+    int helpers = 0;
+    started[0] = false;
+    for (int t = 1; t < threads; t++) {
+        started[t] = pthread_create(&ids[t], NULL, queryWorkerRun, &workers[t]) == 0;
+        if (started[t]) helpers++;
+    }
+
+    for (long from = 0; from < patterns.count; from += QUERY_WINDOW) {
+        // помощники сейчас ждут окна, их буферы можно трогать
+        pthread_mutex_lock(&pool.lock);
+        pool.from = from;
+        pool.to = from + QUERY_WINDOW < patterns.count ? from + QUERY_WINDOW : patterns.count;
+        pool.next = from;
+        for (int t = 0; t < threads; t++) workers[t].out.size = 0;
+        pool.pending = helpers;
+        pool.window++;
+        pthread_cond_broadcast(&pool.windowReady);
+        pthread_mutex_unlock(&pool.lock);
+
+        answerBlocks(&workers[0]);
+
+        pthread_mutex_lock(&pool.lock);
+        while (pool.pending > 0) pthread_cond_wait(&pool.windowDone, &pool.lock);
+        pthread_mutex_unlock(&pool.lock);
+
+        for (long i = 0; i < pool.to - pool.from; i++) {
+            // паттерн без вхождений ничего не печатает, а буфер потока может быть еще пуст
+            if (pool.lengths[i] == 0) continue;
+            fwrite(workers[pool.owners[i]].out.data + pool.offsets[i], 1, pool.lengths[i], stdout);
+        }
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    pool.stop = true;
+    pthread_cond_broadcast(&pool.windowReady);
+    pthread_mutex_unlock(&pool.lock);
+
+    for (int t = 1; t < threads; t++) {
+        if (started[t]) pthread_join(ids[t], NULL);
+    }
+
+    for (int t = 0; t < threads; t++) {
+        free(workers[t].out.data);
+        free(workers[t].matches);
+    }
+
+    free(workers);
+    free(ids);
+    free(started);
+    free(pool.owners);
+    free(pool.offsets);
+    free(pool.lengths);
+    pthread_cond_destroy(&pool.windowReady);
+    pthread_cond_destroy(&pool.windowDone);
+    pthread_mutex_destroy(&pool.lock);
+    deletePatterns(&patterns);
+}